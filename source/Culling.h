@@ -0,0 +1,247 @@
+#pragma once
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+#include "Math.h"
+
+namespace dae
+{
+	//Points with Dot(normal, p) + distance >= 0 are on the inner side
+	struct Plane
+	{
+		Vector3 normal{};
+		float distance{};
+	};
+
+	//Axis aligned, empty (min > max) until something gets added
+	struct BoundingBox
+	{
+		Vector3 min{ FLT_MAX, FLT_MAX, FLT_MAX };
+		Vector3 max{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		void Grow(const Vector3& point)
+		{
+			for (int i{}; i < 3; ++i)
+			{
+				min[i] = std::min(min[i], point[i]);
+				max[i] = std::max(max[i], point[i]);
+			}
+		}
+
+		void Grow(const BoundingBox& box)
+		{
+			for (int i{}; i < 3; ++i)
+			{
+				min[i] = std::min(min[i], box.min[i]);
+				max[i] = std::max(max[i], box.max[i]);
+			}
+		}
+
+		Vector3 GetCenter() const
+		{
+			return (min + max) * 0.5f;
+		}
+
+		//Box around the transformed box, every output axis takes the extreme of each matrix term separately (Arvo)
+		BoundingBox Transformed(const Matrix& matrix) const
+		{
+			BoundingBox box{};
+			for (int column{}; column < 3; ++column)
+			{
+				box.min[column] = box.max[column] = matrix[3][column];
+				for (int row{}; row < 3; ++row)
+				{
+					const float a{ matrix[row][column] * min[row] };
+					const float b{ matrix[row][column] * max[row] };
+					box.min[column] += std::min(a, b);
+					box.max[column] += std::max(a, b);
+				}
+			}
+			return box;
+		}
+	};
+
+	struct Frustum
+	{
+		//Left, right, bottom, top, near, far
+		Plane planes[6]{};
+
+		//Clip volume (-w <= x, y <= w, 0 <= z <= w) of a row-vector matrix, in the space that matrix transforms from
+		static Frustum FromMatrix(const Matrix& matrix)
+		{
+			const auto column = [&](int index)
+				{
+					return Vector4{ matrix[0][index], matrix[1][index], matrix[2][index], matrix[3][index] };
+				};
+			const Vector4 x{ column(0) }, y{ column(1) }, z{ column(2) }, w{ column(3) };
+			const Vector4 planeEquations[6]{ w + x, w - x, w + y, w - y, z, w - z };
+
+			Frustum frustum{};
+			for (int i{}; i < 6; ++i)
+			{
+				//Normalized, so the plane equation gives real distances
+				const Vector3 normal{ planeEquations[i].x, planeEquations[i].y, planeEquations[i].z };
+				const float magnitude{ normal.Magnitude() };
+				frustum.planes[i] = Plane{ normal / magnitude, planeEquations[i].w / magnitude };
+			}
+			return frustum;
+		}
+
+		bool IsSphereOutside(const Vector3& center, float radius) const
+		{
+			for (const Plane& plane : planes)
+			{
+				if (Vector3::Dot(plane.normal, center) + plane.distance < -radius)
+					return true;
+			}
+			return false;
+		}
+
+		//Only tests the corner farthest along each plane normal, boxes near a frustum corner can be kept while outside
+		bool IsBoxOutside(const BoundingBox& box) const
+		{
+			for (const Plane& plane : planes)
+			{
+				const Vector3 farthest{ plane.normal.x >= 0.f ? box.max.x : box.min.x,
+					plane.normal.y >= 0.f ? box.max.y : box.min.y,
+					plane.normal.z >= 0.f ? box.max.z : box.min.z };
+				if (Vector3::Dot(plane.normal, farthest) + plane.distance < 0.f)
+					return true;
+			}
+			return false;
+		}
+	};
+
+	//Mip chain of the farthest depth, level 0 has one texel per block of blockSize x blockSize pixels
+	//Remembers the view projection it was rendered with, bounds get projected with that one to line up with the depths
+	struct DepthPyramid
+	{
+		struct Level
+		{
+			int width{};
+			int height{};
+			std::vector<float> maxDepths{};
+		};
+
+		std::vector<Level> levels{};
+		int blockSize{};
+		int screenWidth{};
+		int screenHeight{};
+		Matrix viewProjection{};
+		bool isValid{ false };
+
+		//pBlockMaxDepths: farthest depth of every block, row-major
+		void Build(const float* pBlockMaxDepths, int nrBlocksX, int nrBlocksY, int pixelsPerBlock, int width, int height, const Matrix& renderViewProjection)
+		{
+			blockSize = pixelsPerBlock;
+			screenWidth = width;
+			screenHeight = height;
+			viewProjection = renderViewProjection;
+			isValid = true;
+
+			//The levels are kept from frame to frame, they only get reallocated when the resolution changes
+			//Odd sizes round up, the missing texels of the last row or column just don't contribute
+			if (levels.empty() || levels[0].width != nrBlocksX || levels[0].height != nrBlocksY)
+			{
+				levels.clear();
+				levels.push_back(Level{ nrBlocksX, nrBlocksY });
+				while (levels.back().width > 1 || levels.back().height > 1)
+				{
+					const Level& previous{ levels.back() };
+					levels.push_back(Level{ (previous.width + 1) / 2, (previous.height + 1) / 2 });
+				}
+				for (Level& level : levels)
+				{
+					level.maxDepths.resize(static_cast<size_t>(level.width) * level.height);
+				}
+			}
+
+			std::copy(pBlockMaxDepths, pBlockMaxDepths + nrBlocksX * nrBlocksY, levels[0].maxDepths.begin());
+			for (size_t levelIdx{ 1 }; levelIdx < levels.size(); ++levelIdx)
+			{
+				const Level& previous{ levels[levelIdx - 1] };
+				Level& level{ levels[levelIdx] };
+
+				for (int y{}; y < level.height; ++y)
+				{
+					for (int x{}; x < level.width; ++x)
+					{
+						float maxDepth{ -FLT_MAX };
+						for (int sourceY{ y * 2 }; sourceY < std::min(y * 2 + 2, previous.height); ++sourceY)
+						{
+							for (int sourceX{ x * 2 }; sourceX < std::min(x * 2 + 2, previous.width); ++sourceX)
+							{
+								maxDepth = std::max(maxDepth, previous.maxDepths[sourceX + sourceY * previous.width]);
+							}
+						}
+						level.maxDepths[x + y * level.width] = maxDepth;
+					}
+				}
+			}
+		}
+
+		//True when the box (in the space toClip transforms from, toClip = ... * viewProjection) lies behind every depth
+		//of the pixels it covers. Boxes reaching behind the camera or past the screen edges never count as occluded
+		bool IsBoxOccluded(const Matrix& toClip, const Vector3& min, const Vector3& max) const
+		{
+			if (!isValid)
+				return false;
+
+			float minX{ FLT_MAX }, minY{ FLT_MAX }, maxX{ -FLT_MAX }, maxY{ -FLT_MAX };
+			float minDepth{ FLT_MAX };
+			for (int corner{}; corner < 8; ++corner)
+			{
+				const Vector4 clip{ toClip.TransformPoint(Vector4{ corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z, 1.f }) };
+				if (clip.w <= 0.f || clip.z < 0.f)
+					return false;
+
+				//Same mapping as the raster vertices, the depth is the same perspective divided z the depth buffer holds
+				const float x{ (clip.x / clip.w + 1) * 0.5f * screenWidth };
+				const float y{ (1 - clip.y / clip.w) * 0.5f * screenHeight };
+				minX = std::min(minX, x);
+				minY = std::min(minY, y);
+				maxX = std::max(maxX, x);
+				maxY = std::max(maxY, y);
+				minDepth = std::min(minDepth, clip.z / clip.w);
+			}
+
+			if (minX < 0.f || minY < 0.f || maxX >= static_cast<float>(screenWidth) || maxY >= static_cast<float>(screenHeight))
+				return false;
+
+			//Coarsest level where the rectangle still touches at most 2 x 2 texels
+			int firstX{ static_cast<int>(minX) / blockSize };
+			int firstY{ static_cast<int>(minY) / blockSize };
+			int lastX{ static_cast<int>(maxX) / blockSize };
+			int lastY{ static_cast<int>(maxY) / blockSize };
+			size_t levelIdx{};
+			while (lastX - firstX > 1 || lastY - firstY > 1)
+			{
+				firstX >>= 1;
+				firstY >>= 1;
+				lastX >>= 1;
+				lastY >>= 1;
+				++levelIdx;
+			}
+
+			const Level& level{ levels[levelIdx] };
+			for (int y{ firstY }; y <= lastY; ++y)
+			{
+				for (int x{ firstX }; x <= lastX; ++x)
+				{
+					if (minDepth <= level.maxDepths[x + y * level.width])
+						return false;
+				}
+			}
+			return true;
+		}
+	};
+
+	//True when every triangle with a normal inside the cone (axis, sin of its half angle = coneCutoff) and all its points
+	//inside the sphere faces away from the camera. Front faces have normals pointing towards the camera
+	inline bool IsConeBackFacing(const Vector3& center, float radius, const Vector3& coneAxis, float coneCutoff, const Vector3& cameraPosition)
+	{
+		const Vector3 toCenter{ center - cameraPosition };
+		return Vector3::Dot(toCenter, coneAxis) > coneCutoff * toCenter.Magnitude() + radius;
+	}
+}
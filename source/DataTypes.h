@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include "Math.h"
 #include "vector"
 
@@ -24,6 +25,87 @@ namespace dae
 		Vector3 viewDirection{};
 	};
 
+	//Structure of arrays copy of Mesh::vertices for the SIMD vertex transform
+	//The streams that get transformed are split per component and padded (see BuildVertexStreams), the rest only gets copied
+	struct VertexStreams
+	{
+		size_t count{};
+
+		std::vector<float> positionX{};
+		std::vector<float> positionY{};
+		std::vector<float> positionZ{};
+		std::vector<float> normalX{};
+		std::vector<float> normalY{};
+		std::vector<float> normalZ{};
+
+		std::vector<ColorRGB> color{};
+		std::vector<Vector2> uv{};
+		std::vector<Vector3> tangent{};
+	};
+
+	//Vertex indices (into Mesh::vertices_out) of one assembled triangle
+	struct Triangle
+	{
+		uint32_t v0{};
+		uint32_t v1{};
+		uint32_t v2{};
+	};
+
+	//Screen space plane equation of an attribute, relative to the triangle's first vertex
+	struct AttributePlane
+	{
+		float value{}; //at the first vertex
+		float dx{};
+		float dy{};
+
+		float Evaluate(float offsetX, float offsetY) const
+		{
+			return value + dx * offsetX + dy * offsetY;
+		}
+	};
+
+	//Everything the rasterizer and pixel shading need of one triangle, built once after culling
+	//Attributes are divided by w, so perspective correct interpolation is a plane lookup and one multiply
+	struct TriangleSetup
+	{
+		Vector2 screenPositions[3]{};
+		float invDepth[3]{};
+		float minDepth{};
+
+		AttributePlane invW{};
+		AttributePlane uv[2]{};
+		AttributePlane normal[3]{};
+		AttributePlane tangent[3]{};
+		AttributePlane viewDirection[3]{};
+
+		//Of the instance, constant over the triangle
+		ColorRGB tint{ 1.f, 1.f, 1.f };
+	};
+
+	//Cluster of a triangle list: the triangles in indices[firstIndex, firstIndex + nrIndices[
+	//Bounds are in object space, see Utils::BuildMeshlets
+	struct Meshlet
+	{
+		uint32_t firstIndex{};
+		uint32_t nrIndices{};
+
+		Vector3 center{};
+		float radius{};
+
+		//Every face normal is within the cone, coneCutoff is the sine of its half angle (1 = too wide to ever be culled)
+		Vector3 coneAxis{};
+		float coneCutoff{ 1.f };
+	};
+
+	//Level of detail of a triangle list: a range of Mesh::meshlets, all levels share Mesh::vertices
+	struct MeshLod
+	{
+		uint32_t firstMeshlet{};
+		uint32_t nrMeshlets{};
+		//Largest object space distance between the level and the full detail mesh, see Utils::MeshSimplifier
+		float error{};
+	};
+
 	enum class PrimitiveTopology
 	{
 		TriangleList,
@@ -36,7 +118,12 @@ namespace dae
 		std::vector<uint32_t> indices{};
 		PrimitiveTopology primitiveTopology{ PrimitiveTopology::TriangleList };
 
+		//Scratch for the instance being drawn, instances only have their own world matrix (see MeshInstance)
 		std::vector<Vertex_Out> vertices_out{};
-		Matrix worldMatrix{};
+
+		VertexStreams vertexStreams{};
+		std::vector<Meshlet> meshlets{};
+		//Triangle lists only, the first level is the full mesh
+		std::vector<MeshLod> lods{};
 	};
 }
\ No newline at end of file
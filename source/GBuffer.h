@@ -0,0 +1,65 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "Math.h"
+
+namespace dae
+{
+	//Packing of the deferred G-buffer planes, every plane holds one 32 bit value per pixel
+
+	//Unit vector to 2 x 16 bits: projected onto the octahedron |x| + |y| + |z| = 1, its lower half folded over the upper one
+	inline uint32_t EncodeOctahedral(const Vector3& normal)
+	{
+		const float invLength{ 1.f / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z)) };
+		float x{ normal.x * invLength };
+		float y{ normal.y * invLength };
+		if (normal.z < 0.f)
+		{
+			const float foldedX{ (1.f - std::abs(y)) * (x >= 0.f ? 1.f : -1.f) };
+			y = (1.f - std::abs(x)) * (y >= 0.f ? 1.f : -1.f);
+			x = foldedX;
+		}
+
+		const auto toUnorm16 = [](float value)
+			{
+				return static_cast<uint32_t>(std::clamp(value * 0.5f + 0.5f, 0.f, 1.f) * 65535.f + 0.5f);
+			};
+		return toUnorm16(x) | toUnorm16(y) << 16;
+	}
+
+	//Normalized
+	inline Vector3 DecodeOctahedral(uint32_t encoded)
+	{
+		const float x{ (encoded & 0xFFFF) / 65535.f * 2.f - 1.f };
+		const float y{ (encoded >> 16) / 65535.f * 2.f - 1.f };
+		Vector3 normal{ x, y, 1.f - std::abs(x) - std::abs(y) };
+
+		//Unfold the lower half
+		const float fold{ std::max(-normal.z, 0.f) };
+		normal.x += normal.x >= 0.f ? -fold : fold;
+		normal.y += normal.y >= 0.f ? -fold : fold;
+		return normal.Normalized();
+	}
+
+	//Colors in [0, 1] to 8 bits per channel, w goes in the top byte
+	inline uint32_t PackUnorm8(const ColorRGB& color, float w = 0.f)
+	{
+		const auto toUnorm8 = [](float value)
+			{
+				return static_cast<uint32_t>(std::clamp(value, 0.f, 1.f) * 255.f + 0.5f);
+			};
+		return toUnorm8(color.r) | toUnorm8(color.g) << 8 | toUnorm8(color.b) << 16 | toUnorm8(w) << 24;
+	}
+
+	inline ColorRGB UnpackUnorm8(uint32_t packed)
+	{
+		return ColorRGB{ (packed & 0xFF) / 255.f, (packed >> 8 & 0xFF) / 255.f, (packed >> 16 & 0xFF) / 255.f };
+	}
+
+	inline float UnpackUnorm8W(uint32_t packed)
+	{
+		return (packed >> 24) / 255.f;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+#include "Math.h"
+
+namespace dae
+{
+	enum class LightType
+	{
+		Directional,
+		Point,
+		Spot
+	};
+
+	struct Light
+	{
+		LightType type{ LightType::Directional };
+		//Point and spot lights
+		Vector3 position{};
+		//Directional and spot lights: the (normalized) direction the light travels in
+		Vector3 direction{};
+		ColorRGB color{ 1.f, 1.f, 1.f };
+		float intensity{ 1.f };
+		//Point and spot lights fade out to nothing at this distance
+		float range{};
+		//Spot lights: cosine of the angle to the direction where the falloff starts and where it reaches nothing
+		float cosInnerCone{};
+		float cosOuterCone{};
+
+		static Light CreateDirectional(const Vector3& direction, float intensity, const ColorRGB& color = ColorRGB{ 1.f, 1.f, 1.f })
+		{
+			return Light{ LightType::Directional, Vector3::Zero, direction.Normalized(), color, intensity };
+		}
+
+		static Light CreatePoint(const Vector3& position, float range, float intensity, const ColorRGB& color = ColorRGB{ 1.f, 1.f, 1.f })
+		{
+			return Light{ LightType::Point, position, Vector3::Zero, color, intensity, range };
+		}
+
+		//Angles in degrees, from the direction to the edge of the cone, innerAngle < outerAngle
+		static Light CreateSpot(const Vector3& position, const Vector3& direction, float innerAngle, float outerAngle, float range, float intensity, const ColorRGB& color = ColorRGB{ 1.f, 1.f, 1.f })
+		{
+			return Light{ LightType::Spot, position, direction.Normalized(), color, intensity, range, cosf(innerAngle * TO_RADIANS), cosf(outerAngle * TO_RADIANS) };
+		}
+	};
+
+	//Falloff of point and spot lights at distanceSquared < range^2, toLight is normalized. Directional lights don't have any
+	//Goes from 1 at the light to 0 at its range, spot lights also fade out between their inner and outer cone
+	inline float GetLightAttenuation(const Light& light, const Vector3& toLight, float distanceSquared)
+	{
+		const float window{ 1.f - distanceSquared / (light.range * light.range) };
+		float attenuation{ window * window };
+		if (light.type == LightType::Spot)
+		{
+			const float cosAngle{ -Vector3::Dot(toLight, light.direction) };
+			const float t{ std::clamp((cosAngle - light.cosOuterCone) / (light.cosInnerCone - light.cosOuterCone), 0.f, 1.f) };
+			attenuation *= t * t * (3.f - 2.f * t);
+		}
+		return attenuation;
+	}
+}
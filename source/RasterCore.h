@@ -0,0 +1,126 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "Vector2.h"
+
+namespace dae
+{
+	//Vertices get snapped to 1/16th of a pixel (28.4 fixed point) before the edge functions are set up
+	constexpr int SUBPIXEL_BITS{ 4 };
+	constexpr int SUBPIXEL_STEPS{ 1 << SUBPIXEL_BITS };
+	constexpr int SUBPIXEL_HALF{ SUBPIXEL_STEPS / 2 };
+
+	//Integer edge function E(x, y), positive inside the triangle
+	//value is E at the first sample of the bounding box, a sample is covered when value - bias >= 0 for all three edges
+	//The bias (fill rule) is kept apart so the barycentric weights stay exact
+	struct EdgeFunction
+	{
+		int64_t value{};
+		int64_t stepX{}; //change of E when moving one pixel to the right
+		int64_t stepY{}; //change of E when moving one pixel down
+		int64_t bias{};
+	};
+
+	struct TriangleEdges
+	{
+		//edges[0]: p0 -> p1, edges[1]: p1 -> p2, edges[2]: p2 -> p0
+		EdgeFunction edges[3]{};
+		float invArea{};
+
+		//Pixels (inclusive - exclusive) whose sample centre can be covered
+		int minX{};
+		int minY{};
+		int maxX{};
+		int maxY{};
+	};
+
+	inline int64_t ToFixedPoint(float value)
+	{
+		return static_cast<int64_t>(std::lround(value * SUBPIXEL_STEPS));
+	}
+
+	//Position the rasterizer actually uses, in pixels
+	inline Vector2 SnapToSubpixel(const Vector2& position)
+	{
+		return Vector2{ static_cast<float>(ToFixedPoint(position.x)) / SUBPIXEL_STEPS, static_cast<float>(ToFixedPoint(position.y)) / SUBPIXEL_STEPS };
+	}
+
+	//Twice the signed area of the snapped triangle in fixed point units, positive for front faces (clockwise on screen)
+	inline int64_t CalculateSignedArea(const Vector2& p0, const Vector2& p1, const Vector2& p2)
+	{
+		const int64_t x0{ ToFixedPoint(p0.x) }, y0{ ToFixedPoint(p0.y) };
+		const int64_t x1{ ToFixedPoint(p1.x) }, y1{ ToFixedPoint(p1.y) };
+		const int64_t x2{ ToFixedPoint(p2.x) }, y2{ ToFixedPoint(p2.y) };
+
+		return (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+	}
+
+	//True when the bounding box of the snapped triangle doesn't contain a single pixel centre
+	inline bool IsMicroTriangle(const Vector2& p0, const Vector2& p1, const Vector2& p2)
+	{
+		const int64_t x[3]{ ToFixedPoint(p0.x), ToFixedPoint(p1.x), ToFixedPoint(p2.x) };
+		const int64_t y[3]{ ToFixedPoint(p0.y), ToFixedPoint(p1.y), ToFixedPoint(p2.y) };
+
+		const int64_t firstSampleX{ (std::min(x[0], std::min(x[1], x[2])) - SUBPIXEL_HALF + SUBPIXEL_STEPS - 1) >> SUBPIXEL_BITS };
+		const int64_t firstSampleY{ (std::min(y[0], std::min(y[1], y[2])) - SUBPIXEL_HALF + SUBPIXEL_STEPS - 1) >> SUBPIXEL_BITS };
+		const int64_t lastSampleX{ (std::max(x[0], std::max(x[1], x[2])) - SUBPIXEL_HALF) >> SUBPIXEL_BITS };
+		const int64_t lastSampleY{ (std::max(y[0], std::max(y[1], y[2])) - SUBPIXEL_HALF) >> SUBPIXEL_BITS };
+
+		return firstSampleX > lastSampleX || firstSampleY > lastSampleY;
+	}
+
+	//Top-left rule (y down, clockwise triangles): samples exactly on an edge only belong to the triangle
+	//if that edge is a top edge (horizontal, going right) or a left edge (going up)
+	inline bool IsTopLeftEdge(int64_t dx, int64_t dy)
+	{
+		return dy < 0 || (dy == 0 && dx > 0);
+	}
+
+	//Sets up the fixed point edge functions of a screen space triangle, sampled at pixel centres
+	//and clipped to [clipMinX, clipMaxX[ x [clipMinY, clipMaxY[
+	//Returns false when the triangle has no positive area or covers no sample in the clip rectangle
+	inline bool SetupTriangleEdges(const Vector2& p0, const Vector2& p1, const Vector2& p2,
+		int clipMinX, int clipMinY, int clipMaxX, int clipMaxY, TriangleEdges& triangleEdges)
+	{
+		const int64_t x[3]{ ToFixedPoint(p0.x), ToFixedPoint(p1.x), ToFixedPoint(p2.x) };
+		const int64_t y[3]{ ToFixedPoint(p0.y), ToFixedPoint(p1.y), ToFixedPoint(p2.y) };
+
+		const int64_t area{ (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]) };
+		if (area <= 0)
+			return false;
+
+		//First sample centre at or after the min, last sample centre at or before the max
+		const int64_t minXFixed{ std::min(x[0], std::min(x[1], x[2])) };
+		const int64_t minYFixed{ std::min(y[0], std::min(y[1], y[2])) };
+		const int64_t maxXFixed{ std::max(x[0], std::max(x[1], x[2])) };
+		const int64_t maxYFixed{ std::max(y[0], std::max(y[1], y[2])) };
+
+		triangleEdges.minX = static_cast<int>(std::clamp<int64_t>((minXFixed - SUBPIXEL_HALF + SUBPIXEL_STEPS - 1) >> SUBPIXEL_BITS, clipMinX, clipMaxX));
+		triangleEdges.minY = static_cast<int>(std::clamp<int64_t>((minYFixed - SUBPIXEL_HALF + SUBPIXEL_STEPS - 1) >> SUBPIXEL_BITS, clipMinY, clipMaxY));
+		triangleEdges.maxX = static_cast<int>(std::clamp<int64_t>(((maxXFixed - SUBPIXEL_HALF) >> SUBPIXEL_BITS) + 1, clipMinX, clipMaxX));
+		triangleEdges.maxY = static_cast<int>(std::clamp<int64_t>(((maxYFixed - SUBPIXEL_HALF) >> SUBPIXEL_BITS) + 1, clipMinY, clipMaxY));
+
+		if (triangleEdges.minX >= triangleEdges.maxX || triangleEdges.minY >= triangleEdges.maxY)
+			return false;
+
+		const int64_t sampleX{ static_cast<int64_t>(triangleEdges.minX) * SUBPIXEL_STEPS + SUBPIXEL_HALF };
+		const int64_t sampleY{ static_cast<int64_t>(triangleEdges.minY) * SUBPIXEL_STEPS + SUBPIXEL_HALF };
+
+		for (int i{}; i < 3; ++i)
+		{
+			const int next{ (i + 1) % 3 };
+			const int64_t dx{ x[next] - x[i] };
+			const int64_t dy{ y[next] - y[i] };
+
+			EdgeFunction& edge{ triangleEdges.edges[i] };
+			edge.value = dx * (sampleY - y[i]) - dy * (sampleX - x[i]);
+			edge.stepX = -dy * SUBPIXEL_STEPS;
+			edge.stepY = dx * SUBPIXEL_STEPS;
+			edge.bias = IsTopLeftEdge(dx, dy) ? 0 : 1;
+		}
+
+		triangleEdges.invArea = 1.f / static_cast<float>(area);
+		return true;
+	}
+}
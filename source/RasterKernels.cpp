@@ -0,0 +1,238 @@
+#include "RasterKernels.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//MSVC allows any intrinsic everywhere, GCC and Clang need to be told per function
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE4 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE4
+#define TARGET_AVX2
+#endif
+
+//Note: the kernels deliberately don't use FMA, so every path rounds exactly like the scalar reference
+
+namespace dae
+{
+	template<DepthTest depthTest>
+	uint32_t RasterizeSpanScalar(const SpanEdges& edges, const float invDepth[3], float invArea, int count, float* pDepth, PixelSpan& span)
+	{
+		uint32_t passMask{};
+
+		int64_t edge0{ edges.value[0] };
+		int64_t edge1{ edges.value[1] };
+		int64_t edge2{ edges.value[2] };
+
+		for (int i{}; i < count; ++i, edge0 += edges.stepX[0], edge1 += edges.stepX[1], edge2 += edges.stepX[2])
+		{
+			//All three biased edge values have to be >= 0 (sign bits clear)
+			if (((edge0 - edges.bias[0]) | (edge1 - edges.bias[1]) | (edge2 - edges.bias[2])) < 0)
+				continue;
+
+			const float weight0{ static_cast<float>(edge1) * invArea };
+			const float weight1{ static_cast<float>(edge2) * invArea };
+			const float weight2{ static_cast<float>(edge0) * invArea };
+
+			//Calculate the Z depth at this pixel
+			const float interpolatedZDepth{ 1.0f / (weight0 * invDepth[0] + weight1 * invDepth[1] + weight2 * invDepth[2]) };
+
+			if constexpr (depthTest == DepthTest::Equal)
+			{
+				if (pDepth[i] != interpolatedZDepth)
+					continue;
+			}
+			else
+			{
+				if (pDepth[i] < interpolatedZDepth)
+					continue;
+
+				pDepth[i] = interpolatedZDepth;
+			}
+
+			span.weight0[i] = weight0;
+			span.weight1[i] = weight1;
+			span.weight2[i] = weight2;
+			span.depth[i] = interpolatedZDepth;
+			passMask |= 1u << i;
+		}
+
+		return passMask;
+	}
+
+	template uint32_t RasterizeSpanScalar<DepthTest::Less>(const SpanEdges&, const float[3], float, int, float*, PixelSpan&);
+	template uint32_t RasterizeSpanScalar<DepthTest::Equal>(const SpanEdges&, const float[3], float, int, float*, PixelSpan&);
+
+	bool FitsSimdRange(const SpanEdges& edges)
+	{
+		//|value + 7 * stepX| stays below 2^31, so every lane is exact in 32 bit
+		constexpr int64_t maxValue{ int64_t{ 1 } << 30 };
+		constexpr int64_t maxStep{ int64_t{ 1 } << 26 };
+
+		for (int i{}; i < 3; ++i)
+		{
+			if (std::llabs(edges.value[i]) > maxValue || std::llabs(edges.stepX[i]) > maxStep)
+				return false;
+		}
+		return true;
+	}
+
+	template<DepthTest depthTest>
+	TARGET_SSE4 static uint32_t RasterizeHalfSpanSSE4(const SpanEdges& edges, const float invDepth[3], float invArea, int firstLane, int count, float* pDepth, PixelSpan& span)
+	{
+		const __m128i laneIdx{ _mm_setr_epi32(firstLane, firstLane + 1, firstLane + 2, firstLane + 3) };
+		const __m128i validLanes{ _mm_cmpgt_epi32(_mm_set1_epi32(count), laneIdx) };
+
+		__m128i edge[3];
+		__m128i biasedEdges{ _mm_setzero_si128() };
+		for (int i{}; i < 3; ++i)
+		{
+			edge[i] = _mm_add_epi32(_mm_set1_epi32(static_cast<int32_t>(edges.value[i])), _mm_mullo_epi32(laneIdx, _mm_set1_epi32(static_cast<int32_t>(edges.stepX[i]))));
+			biasedEdges = _mm_or_si128(biasedEdges, _mm_sub_epi32(edge[i], _mm_set1_epi32(static_cast<int32_t>(edges.bias[i]))));
+		}
+		const __m128i covered{ _mm_andnot_si128(_mm_srai_epi32(biasedEdges, 31), validLanes) };
+
+		const __m128 invAreaSIMD{ _mm_set1_ps(invArea) };
+		const __m128 weight0{ _mm_mul_ps(_mm_cvtepi32_ps(edge[1]), invAreaSIMD) };
+		const __m128 weight1{ _mm_mul_ps(_mm_cvtepi32_ps(edge[2]), invAreaSIMD) };
+		const __m128 weight2{ _mm_mul_ps(_mm_cvtepi32_ps(edge[0]), invAreaSIMD) };
+
+		const __m128 sum{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(weight0, _mm_set1_ps(invDepth[0])), _mm_mul_ps(weight1, _mm_set1_ps(invDepth[1]))), _mm_mul_ps(weight2, _mm_set1_ps(invDepth[2]))) };
+		const __m128 depth{ _mm_div_ps(_mm_set1_ps(1.f), sum) };
+
+		//Same tests as the scalar path: pass unless buffer < depth, or only when buffer == depth
+		const __m128 storedDepth{ _mm_loadu_ps(pDepth + firstLane) };
+		const __m128 depthPass{ depthTest == DepthTest::Equal ? _mm_cmpeq_ps(storedDepth, depth) : _mm_cmpnlt_ps(storedDepth, depth) };
+		const __m128 pass{ _mm_and_ps(depthPass, _mm_castsi128_ps(covered)) };
+
+		if constexpr (depthTest == DepthTest::Less)
+			_mm_storeu_ps(pDepth + firstLane, _mm_blendv_ps(storedDepth, depth, pass));
+		_mm_store_ps(span.weight0 + firstLane, weight0);
+		_mm_store_ps(span.weight1 + firstLane, weight1);
+		_mm_store_ps(span.weight2 + firstLane, weight2);
+		_mm_store_ps(span.depth + firstLane, depth);
+
+		return static_cast<uint32_t>(_mm_movemask_ps(pass)) << firstLane;
+	}
+
+	template<DepthTest depthTest>
+	TARGET_SSE4 static uint32_t RasterizeSpanSSE4(const SpanEdges& edges, const float invDepth[3], float invArea, int count, float* pDepth, PixelSpan& span)
+	{
+		//Partial spans go through a local copy so we never touch memory past the end of the row
+		float localDepth[SPAN_WIDTH]{};
+		float* pSpanDepth{ pDepth };
+		if (count < SPAN_WIDTH)
+		{
+			std::memcpy(localDepth, pDepth, count * sizeof(float));
+			pSpanDepth = localDepth;
+		}
+
+		const uint32_t passMask{ RasterizeHalfSpanSSE4<depthTest>(edges, invDepth, invArea, 0, count, pSpanDepth, span) |
+			RasterizeHalfSpanSSE4<depthTest>(edges, invDepth, invArea, 4, count, pSpanDepth, span) };
+
+		if (depthTest == DepthTest::Less && count < SPAN_WIDTH)
+			std::memcpy(pDepth, localDepth, count * sizeof(float));
+
+		return passMask;
+	}
+
+	template<DepthTest depthTest>
+	TARGET_AVX2 static uint32_t RasterizeSpanAVX2(const SpanEdges& edges, const float invDepth[3], float invArea, int count, float* pDepth, PixelSpan& span)
+	{
+		const __m256i laneIdx{ _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7) };
+		const __m256i validLanes{ _mm256_cmpgt_epi32(_mm256_set1_epi32(count), laneIdx) };
+
+		__m256i edge[3];
+		__m256i biasedEdges{ _mm256_setzero_si256() };
+		for (int i{}; i < 3; ++i)
+		{
+			edge[i] = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(edges.value[i])), _mm256_mullo_epi32(laneIdx, _mm256_set1_epi32(static_cast<int32_t>(edges.stepX[i]))));
+			biasedEdges = _mm256_or_si256(biasedEdges, _mm256_sub_epi32(edge[i], _mm256_set1_epi32(static_cast<int32_t>(edges.bias[i]))));
+		}
+		const __m256i covered{ _mm256_andnot_si256(_mm256_srai_epi32(biasedEdges, 31), validLanes) };
+		if (_mm256_testz_si256(covered, covered))
+			return 0;
+
+		const __m256 invAreaSIMD{ _mm256_set1_ps(invArea) };
+		const __m256 weight0{ _mm256_mul_ps(_mm256_cvtepi32_ps(edge[1]), invAreaSIMD) };
+		const __m256 weight1{ _mm256_mul_ps(_mm256_cvtepi32_ps(edge[2]), invAreaSIMD) };
+		const __m256 weight2{ _mm256_mul_ps(_mm256_cvtepi32_ps(edge[0]), invAreaSIMD) };
+
+		const __m256 sum{ _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(weight0, _mm256_set1_ps(invDepth[0])), _mm256_mul_ps(weight1, _mm256_set1_ps(invDepth[1]))), _mm256_mul_ps(weight2, _mm256_set1_ps(invDepth[2]))) };
+		const __m256 depth{ _mm256_div_ps(_mm256_set1_ps(1.f), sum) };
+
+		//Masked load/store never touch the lanes past count
+		const __m256 storedDepth{ _mm256_maskload_ps(pDepth, validLanes) };
+		const __m256 pass{ _mm256_and_ps(_mm256_cmp_ps(storedDepth, depth, depthTest == DepthTest::Equal ? _CMP_EQ_OQ : _CMP_NLT_US), _mm256_castsi256_ps(covered)) };
+
+		if constexpr (depthTest == DepthTest::Less)
+			_mm256_maskstore_ps(pDepth, _mm256_castps_si256(pass), depth);
+		_mm256_store_ps(span.weight0, weight0);
+		_mm256_store_ps(span.weight1, weight1);
+		_mm256_store_ps(span.weight2, weight2);
+		_mm256_store_ps(span.depth, depth);
+
+		return static_cast<uint32_t>(_mm256_movemask_ps(pass));
+	}
+
+	SimdLevel DetectSimdLevel()
+	{
+		bool hasSSE4{};
+		bool hasAVX2{};
+
+#if defined(_MSC_VER)
+		int info[4]{};
+		__cpuid(info, 0);
+		const int nrIds{ info[0] };
+
+		__cpuid(info, 1);
+		hasSSE4 = (info[2] & (1 << 19)) != 0;
+		const bool hasOSXSave{ (info[2] & (1 << 27)) != 0 };
+		const bool hasAVX{ (info[2] & (1 << 28)) != 0 };
+
+		//The OS also has to save the ymm registers
+		if (nrIds >= 7 && hasOSXSave && hasAVX && (_xgetbv(0) & 6) == 6)
+		{
+			__cpuidex(info, 7, 0);
+			hasAVX2 = (info[1] & (1 << 5)) != 0;
+		}
+#else
+		__builtin_cpu_init();
+		hasSSE4 = __builtin_cpu_supports("sse4.1");
+		hasAVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+		if (hasAVX2)
+			return SimdLevel::AVX2;
+		if (hasSSE4)
+			return SimdLevel::SSE4;
+		return SimdLevel::Scalar;
+	}
+
+	template<DepthTest depthTest>
+	static RasterizeSpanFunction GetRasterizeSpanFunction(SimdLevel simdLevel)
+	{
+		switch (simdLevel)
+		{
+		case SimdLevel::AVX2:
+			return RasterizeSpanAVX2<depthTest>;
+		case SimdLevel::SSE4:
+			return RasterizeSpanSSE4<depthTest>;
+		default:
+			return RasterizeSpanScalar<depthTest>;
+		}
+	}
+
+	RasterizeSpanFunction GetRasterizeSpanFunction(SimdLevel simdLevel, DepthTest depthTest)
+	{
+		if (depthTest == DepthTest::Equal)
+			return GetRasterizeSpanFunction<DepthTest::Equal>(simdLevel);
+		return GetRasterizeSpanFunction<DepthTest::Less>(simdLevel);
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+
+namespace dae
+{
+	//Number of pixels one span kernel call handles
+	constexpr int SPAN_WIDTH{ 8 };
+
+	enum class SimdLevel
+	{
+		Scalar,
+		SSE4,
+		AVX2
+	};
+
+	//Less: passes unless the stored depth is closer, and writes the depth
+	//Equal: only passes where the stored depth is exactly the interpolated one, doesn't write (second pass of a depth pre-pass)
+	enum class DepthTest
+	{
+		Less,
+		Equal
+	};
+
+	//Edge functions (see RasterCore.h) at the first pixel of a span
+	struct SpanEdges
+	{
+		int64_t value[3]{};
+		int64_t stepX[3]{};
+		int64_t bias[3]{};
+	};
+
+	//Per pixel results of a span, only valid for the lanes set in the returned mask
+	struct PixelSpan
+	{
+		alignas(32) float weight0[SPAN_WIDTH];
+		alignas(32) float weight1[SPAN_WIDTH];
+		alignas(32) float weight2[SPAN_WIDTH];
+		alignas(32) float depth[SPAN_WIDTH];
+	};
+
+	//Tests coverage of count (<= SPAN_WIDTH) pixels of a row, interpolates 1 / z and depth tests against pDepth (see DepthTest)
+	//Returns a bitmask of the pixels that passed (bit i = pixel i)
+	//weight0 belongs to vertex 0 (so comes from edge 1), weight1 to vertex 1 and weight2 to vertex 2
+	using RasterizeSpanFunction = uint32_t(*)(const SpanEdges& edges, const float invDepth[3], float invArea, int count, float* pDepth, PixelSpan& span);
+
+	//Reference implementation, works for any edge range
+	template<DepthTest depthTest>
+	uint32_t RasterizeSpanScalar(const SpanEdges& edges, const float invDepth[3], float invArea, int count, float* pDepth, PixelSpan& span);
+
+	//The SIMD kernels work on 32 bit edge values, only use them when this returns true
+	bool FitsSimdRange(const SpanEdges& edges);
+
+	SimdLevel DetectSimdLevel();
+	RasterizeSpanFunction GetRasterizeSpanFunction(SimdLevel simdLevel, DepthTest depthTest);
+}
@@ -1,19 +1,108 @@
 //External includes
 #include "SDL.h"
 #include "SDL_surface.h"
+#include <bit>
+#include <cassert>
+#include <cstring>
 #include <iostream>
 
 //Project includes
 #include "Renderer.h"
+#include "GBuffer.h"
 #include "Math.h"
 #include "Matrix.h"
+#include "RasterCore.h"
+#include "RasterKernels.h"
+#include "ShadeKernels.h"
 #include "Texture.h"
 #include "Utils.h"
+#include "VertexKernels.h"
 
 //#define TRIANGLE_STRIP
 #define CUSTOM_MESH
+//Reorders the triangles and vertices of the custom mesh for cache locality at load time
+#define OPTIMIZE_MESH
+//Fills the scene with a MESH_GRID x MESH_GRID grid of tinted instances, MESH_GRID_SPACING apart
+//#define MESH_GRID 8
+constexpr float MESH_GRID_SPACING{ 25.f };
+//Replaces the default directional light by a dim moon, with NIGHT_LIGHTS street lamps (spot lights) and point lights over the scene
+//#define NIGHT_LIGHTS 128
 using namespace dae;
 
+//Largest error (in pixels) a level of detail may have at the point of the instance closest to the camera
+constexpr float LOD_MAX_PIXEL_ERROR{ 1.f };
+
+//Scales the gloss map into the specular exponent
+constexpr float GLOSSINESS{ 25.f };
+
+//Spans with fewer passing fragments than this get shaded one pixel at a time, the packet kernels always do all 8 lanes
+constexpr int PACKET_SHADING_MIN_LANES{ 4 };
+
+//Visibility buffer value of pixels no triangle covers
+constexpr uint32_t INVALID_TRIANGLE{ UINT32_MAX };
+//m_TransformedInstanceIdx when mesh.vertices_out holds no instance of this frame
+constexpr uint32_t INVALID_INSTANCE{ UINT32_MAX };
+
+//Clipping outcodes, the first 6 are the view frustum planes
+constexpr uint32_t CLIP_NEAR{ 1 << 0 };
+constexpr uint32_t CLIP_FAR{ 1 << 1 };
+constexpr uint32_t CLIP_LEFT{ 1 << 2 };
+constexpr uint32_t CLIP_RIGHT{ 1 << 3 };
+constexpr uint32_t CLIP_BOTTOM{ 1 << 4 };
+constexpr uint32_t CLIP_TOP{ 1 << 5 };
+constexpr uint32_t CLIP_GUARD_LEFT{ 1 << 6 };
+constexpr uint32_t CLIP_GUARD_RIGHT{ 1 << 7 };
+constexpr uint32_t CLIP_GUARD_BOTTOM{ 1 << 8 };
+constexpr uint32_t CLIP_GUARD_TOP{ 1 << 9 };
+//Planes that triangles actually get clipped against
+constexpr uint32_t CLIP_PLANES{ CLIP_NEAR | CLIP_FAR | CLIP_GUARD_LEFT | CLIP_GUARD_RIGHT | CLIP_GUARD_BOTTOM | CLIP_GUARD_TOP };
+//Guard band in NDC units, x/y only get clipped once a triangle reaches past GUARD_BAND * w
+constexpr float GUARD_BAND{ 8.f };
+
+//Screen tile size (in pixels) used for binning in the tiled renderer
+constexpr int TILE_SIZE{ 64 };
+//Block size (in pixels) of the hierarchical Z buffer, one span per block row
+constexpr int HIZ_BLOCK_SIZE{ SPAN_WIDTH };
+static_assert(TILE_SIZE % HIZ_BLOCK_SIZE == 0, "HiZ blocks can't straddle tiles");
+//Screen tile size (in pixels) of the light lists, spans never straddle two of them
+constexpr int LIGHT_TILE_SIZE{ 16 };
+static_assert(LIGHT_TILE_SIZE % SPAN_WIDTH == 0, "Spans have to stay inside one light tile");
+//The block-linear layout uses the same 8x8 blocks, so every span is 8 consecutive pixels in both layouts
+constexpr int LAYOUT_BLOCK_SIZE{ 8 };
+static_assert(LAYOUT_BLOCK_SIZE == HIZ_BLOCK_SIZE, "Spans can't straddle layout blocks");
+static_assert(std::has_single_bit(static_cast<unsigned>(LAYOUT_BLOCK_SIZE)), "Block-linear addressing uses shifts and masks");
+constexpr int LAYOUT_BLOCK_SHIFT{ std::countr_zero(static_cast<unsigned>(LAYOUT_BLOCK_SIZE)) };
+constexpr int LAYOUT_BLOCK_MASK{ LAYOUT_BLOCK_SIZE - 1 };
+constexpr int LAYOUT_BLOCK_AREA{ LAYOUT_BLOCK_SIZE * LAYOUT_BLOCK_SIZE };
+
+//Depth sorting key: view depth between the near and far plane, quantized to 16 bits, see Utils::RadixSortByKey
+constexpr float DEPTH_SORT_KEY_RANGE{ 65535.f };
+
+//Subpixel snapping can flip the winding of (small) triangles seen almost edge-on, so normal cones
+//only get culled once they face away by a few degrees more than needed (sine of the extra angle)
+constexpr float CONE_SNAP_MARGIN{ 0.05f };
+
+//Fills in the passes every triangle goes through, in order, and returns how many there are
+static int GetRasterPasses(PipelineMode pipelineMode, RasterPass passes[2])
+{
+	switch (pipelineMode)
+	{
+	case PipelineMode::VisibilityBuffer:
+		passes[0] = RasterPass::WriteVisibility;
+		return 1;
+	case PipelineMode::DepthPrepass:
+		passes[0] = RasterPass::DepthOnly;
+		passes[1] = RasterPass::ShadeEqualDepth;
+		return 2;
+	case PipelineMode::Deferred:
+		passes[0] = RasterPass::WriteGBuffer;
+		return 1;
+	default:
+		passes[0] = RasterPass::Shade;
+		return 1;
+	}
+}
+
 Renderer::Renderer(SDL_Window* pWindow) :
 	m_pWindow(pWindow)
 {
@@ -25,7 +114,31 @@ Renderer::Renderer(SDL_Window* pWindow) :
 	m_pBackBuffer = SDL_CreateRGBSurface(0, m_Width, m_Height, 32, 0, 0, 0, 0);
 	m_pBackBufferPixels = (uint32_t*)m_pBackBuffer->pixels;
 
-	m_pDepthBufferPixels = new float[m_Width * m_Height];
+	m_pColorBufferPixels = m_pBackBufferPixels;
+
+	//Padded to whole blocks, so the block-linear layout never needs bounds checks
+	m_PaddedWidth = (m_Width + LAYOUT_BLOCK_SIZE - 1) / LAYOUT_BLOCK_SIZE * LAYOUT_BLOCK_SIZE;
+	m_PaddedHeight = (m_Height + LAYOUT_BLOCK_SIZE - 1) / LAYOUT_BLOCK_SIZE * LAYOUT_BLOCK_SIZE;
+	m_pBlockColorBufferPixels = new uint32_t[m_PaddedWidth * m_PaddedHeight];
+	m_pDepthBufferPixels = new float[m_PaddedWidth * m_PaddedHeight];
+	m_pVisibilityBuffer = new uint32_t[m_PaddedWidth * m_PaddedHeight];
+	m_pGBufferNormals = new uint32_t[m_PaddedWidth * m_PaddedHeight];
+	m_pGBufferAlbedo = new uint32_t[m_PaddedWidth * m_PaddedHeight];
+	m_pGBufferSpecular = new uint32_t[m_PaddedWidth * m_PaddedHeight];
+
+	//Farthest depth per block, conservative
+	m_NrHiZBlocksX = (m_Width + HIZ_BLOCK_SIZE - 1) / HIZ_BLOCK_SIZE;
+	m_NrHiZBlocksY = (m_Height + HIZ_BLOCK_SIZE - 1) / HIZ_BLOCK_SIZE;
+	m_pHiZBuffer = new float[m_NrHiZBlocksX * m_NrHiZBlocksY];
+
+	//Tile bins
+	m_NrTilesX = (m_Width + TILE_SIZE - 1) / TILE_SIZE;
+	m_NrTilesY = (m_Height + TILE_SIZE - 1) / TILE_SIZE;
+	m_TileBins.resize(static_cast<size_t>(m_NrTilesX) * m_NrTilesY);
+
+	//Light lists
+	m_NrLightTilesX = (m_Width + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+	m_NrLightTilesY = (m_Height + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
 
 	//Initialize Camera
 	m_AspectRatio = static_cast<float>(m_Width) / m_Height;
@@ -35,14 +148,31 @@ Renderer::Renderer(SDL_Window* pWindow) :
 	m_pSpecularTexture = Texture::LoadFromFile("Resources/vehicle_specular.png");
 	m_pGlossTexture = Texture::LoadFromFile("Resources/vehicle_gloss.png");
 	InitializeMesh();
+	InitializeLights();
 
 	m_CurrentRendeMode = RenderMode::Texture;
 	m_CurrentColorMode = ColorMode::observedArea;
+
+	//Pick the widest pixel kernel this CPU supports
+	m_MaxSimdLevel = DetectSimdLevel();
+	m_SimdLevel = m_MaxSimdLevel;
+	m_pRasterizeSpan = GetRasterizeSpanFunction(m_SimdLevel, DepthTest::Less);
+	m_pRasterizeSpanEqual = GetRasterizeSpanFunction(m_SimdLevel, DepthTest::Equal);
+
+	//CullLights rebuilds it when the glossiness changes, the packet lookup only gets checked once
+	m_SpecularPowerTable.Build(GLOSSINESS);
+	assert(MatchesScalarSpecularLookup(m_MaxSimdLevel, m_SpecularPowerTable) && "Packet and scalar specular lookups differ");
 }
 
 Renderer::~Renderer()
 {
+	delete[] m_pBlockColorBufferPixels;
 	delete[] m_pDepthBufferPixels;
+	delete[] m_pHiZBuffer;
+	delete[] m_pVisibilityBuffer;
+	delete[] m_pGBufferNormals;
+	delete[] m_pGBufferAlbedo;
+	delete[] m_pGBufferSpecular;
 	delete m_MeshTexture;
 	delete m_pNormalTexture;
 	delete m_pSpecularTexture;
@@ -56,7 +186,11 @@ void Renderer::Update(Timer* pTimer)
 	if (m_CanRotate)
 	{
 		const float meshRotationSpeed{ 50.0f };
-		m_MeshWorld.worldMatrix = Matrix::CreateRotationY(meshRotationSpeed * pTimer->GetElapsed() * TO_RADIANS) * m_MeshWorld.worldMatrix;
+		const Matrix rotation{ Matrix::CreateRotationY(meshRotationSpeed * pTimer->GetElapsed() * TO_RADIANS) };
+		for (uint32_t instanceIdx{}; instanceIdx < m_Scene.GetNrInstances(); ++instanceIdx)
+		{
+			m_Scene.SetWorldMatrix(instanceIdx, rotation * m_Scene.GetInstance(instanceIdx).worldMatrix);
+		}
 	}
 }
 
@@ -65,23 +199,116 @@ void Renderer::Render()
 	//@START
 	//Lock BackBuffer
 	SDL_LockSurface(m_pBackBuffer);
-	std::fill_n(m_pDepthBufferPixels, m_Width * m_Height, FLT_MAX);
+	SelectShadingFunctions();
+	std::fill_n(m_pDepthBufferPixels, m_PaddedWidth * m_PaddedHeight, FLT_MAX);
+	std::fill_n(m_pHiZBuffer, m_NrHiZBlocksX * m_NrHiZBlocksY, FLT_MAX);
+	if (m_CurrentPipelineMode == PipelineMode::VisibilityBuffer)
+		std::fill_n(m_pVisibilityBuffer, m_PaddedWidth * m_PaddedHeight, INVALID_TRIANGLE);
 
 	Uint32 clearColor{ 100 };
-	SDL_FillRect(m_pBackBuffer, NULL, SDL_MapRGB(m_pBackBuffer->format, clearColor, clearColor, clearColor));
-
-	std::vector<Vector2> raster_Vertices;
+	const Uint32 mappedClearColor{ SDL_MapRGB(m_pBackBuffer->format, clearColor, clearColor, clearColor) };
+	if (m_CurrentBufferLayout == BufferLayout::Linear)
+		SDL_FillRect(m_pBackBuffer, NULL, mappedClearColor);
+	else
+		std::fill_n(m_pBlockColorBufferPixels, m_PaddedWidth * m_PaddedHeight, mappedClearColor);
+
+	m_TriangleSetups.clear();
+	m_TransformedInstanceIdx = INVALID_INSTANCE;
+	m_OccludedInstances.clear();
+	m_OccludedMeshlets.clear();
+	if (!m_UseOcclusionCulling)
+		m_DepthPyramid.isValid = false;
+
+	//Only instances whose bounds reach into the view frustum get transformed at all
+	const Matrix viewProjectionMatrix{ m_Camera.viewMatrix * m_Camera.projectionMatrix };
+	CullLights(viewProjectionMatrix);
+	m_Scene.UpdateBVH();
+	m_Scene.QueryFrustum(Frustum::FromMatrix(viewProjectionMatrix), m_VisibleInstances);
+	for (uint32_t instanceIdx : m_VisibleInstances)
+	{
+		const MeshInstance& instance{ m_Scene.GetInstance(instanceIdx) };
+		if (IsInstanceOccluded(instance))
+		{
+			m_OccludedInstances.push_back(instanceIdx);
+			continue;
+		}
+		AssembleMesh(m_Scene.GetMesh(instance.meshIdx), instance, instanceIdx, &m_OccludedMeshlets);
+	}
 
-	VertexTransformationFunction();
+	RasterizeTriangles(0);
 
-	for (Vertex_Out& vertex : m_MeshWorld.vertices_out)
+	if (m_UseOcclusionCulling)
 	{
-		raster_Vertices.push_back(Vector2{ (vertex.position.x + 1) * 0.5f * m_Width, (1 - vertex.position.y) * 0.5f * m_Height });
+		//Whatever the previous frame hid gets tested again, against the depth of everything drawn so far
+		const uint32_t firstLateTriangleIdx{ static_cast<uint32_t>(m_TriangleSetups.size()) };
+		const bool hasOccluded{ !m_OccludedInstances.empty() || !m_OccludedMeshlets.empty() };
+		if (hasOccluded)
+		{
+			m_DepthPyramid.Build(m_pHiZBuffer, m_NrHiZBlocksX, m_NrHiZBlocksY, HIZ_BLOCK_SIZE, m_Width, m_Height, viewProjectionMatrix);
+
+			for (uint32_t instanceIdx : m_OccludedInstances)
+			{
+				const MeshInstance& instance{ m_Scene.GetInstance(instanceIdx) };
+				if (!IsInstanceOccluded(instance))
+					AssembleMesh(m_Scene.GetMesh(instance.meshIdx), instance, instanceIdx, nullptr);
+			}
+
+			//The meshlets of one instance are next to each other, its vertices only get transformed once one of them survives
+			//An instance the early pass transformed last still has its vertices, the others only transform what their meshlets use
+			for (size_t i{}; i < m_OccludedMeshlets.size();)
+			{
+				const uint32_t instanceIdx{ m_OccludedMeshlets[i].instanceIdx };
+				const MeshInstance& instance{ m_Scene.GetInstance(instanceIdx) };
+				Mesh& mesh{ m_Scene.GetMesh(instance.meshIdx) };
+				const Matrix toClip{ instance.worldMatrix * m_DepthPyramid.viewProjection };
+
+				bool isTransformed{ false };
+				for (; i < m_OccludedMeshlets.size() && m_OccludedMeshlets[i].instanceIdx == instanceIdx; ++i)
+				{
+					const Meshlet& meshlet{ mesh.meshlets[m_OccludedMeshlets[i].meshletIdx] };
+					if (IsMeshletOccluded(meshlet, toClip))
+						continue;
+
+					if (!isTransformed)
+					{
+						if (instanceIdx != m_TransformedInstanceIdx)
+							BeginInstance(mesh, instance, instanceIdx, true);
+						isTransformed = true;
+					}
+					AssembleMeshlet(mesh, meshlet);
+				}
+			}
+
+			RasterizeTriangles(firstLateTriangleIdx);
+		}
+
+		//Depth is final now, this is what the next frame tests against
+		if (!hasOccluded || m_TriangleSetups.size() > firstLateTriangleIdx)
+			m_DepthPyramid.Build(m_pHiZBuffer, m_NrHiZBlocksX, m_NrHiZBlocksY, HIZ_BLOCK_SIZE, m_Width, m_Height, viewProjectionMatrix);
 	}
 
-	std::vector<uint32_t>& meshIndeces = m_MeshWorld.indices;
-	
-	switch (m_MeshWorld.primitiveTopology)
+	//Second pass: shade every visible pixel exactly once
+	if (m_CurrentPipelineMode == PipelineMode::VisibilityBuffer)
+		ResolveVisibilityBuffer();
+	else if (m_CurrentPipelineMode == PipelineMode::Deferred)
+		ShadeGBuffer();
+
+	if (m_CurrentBufferLayout == BufferLayout::BlockLinear)
+		PresentBlockColorBuffer();
+	//@END
+	//Update SDL Surface
+	SDL_UnlockSurface(m_pBackBuffer);
+	SDL_BlitSurface(m_pBackBuffer, 0, m_pFrontBuffer, 0);
+	SDL_UpdateWindowSurface(m_pWindow);
+}
+
+void dae::Renderer::AssembleMesh(Mesh& mesh, const MeshInstance& instance, uint32_t instanceIdx, std::vector<OccludedMeshlet>* pOccludedMeshlets)
+{
+	BeginInstance(mesh, instance, instanceIdx, false);
+
+	std::vector<uint32_t>& meshIndeces = mesh.indices;
+
+	switch (mesh.primitiveTopology)
 	{
 	case PrimitiveTopology::TriangleStrip:
 		for (size_t i = 0; i + 2 < meshIndeces.size(); ++i)
@@ -96,40 +323,114 @@ void Renderer::Render()
 				idx1 = idx2;
 				idx2 = temp;
 			}
-			RenderTriangle(idx0, idx1, idx2, raster_Vertices);
+			AssembleTriangle(mesh, idx0, idx1, idx2);
 
 		}
 
 		break;
 	case PrimitiveTopology::TriangleList:
-		for (int i = 0; i + 2 < meshIndeces.size(); i += 3)
+	{
+		//Culling happens in object space, so nothing has to be transformed per meshlet
+		const Frustum frustum{ Frustum::FromMatrix(m_WorldViewProjectionMatrix) };
+		const Vector3 cameraPosition{ Matrix::Inverse(m_WorldMatrix).TransformPoint(m_Camera.origin) };
+		const Matrix occlusionToClip{ m_WorldMatrix * m_DepthPyramid.viewProjection };
+
+		const MeshLod& lod{ mesh.lods[SelectLod(mesh, instance)] };
+		for (uint32_t meshletIdx{ lod.firstMeshlet }; meshletIdx < lod.firstMeshlet + lod.nrMeshlets; ++meshletIdx)
 		{
-			int idx0{ i };
-			int idx1{ i + 1 };
-			int idx2{ i + 2 };
+			const Meshlet& meshlet{ mesh.meshlets[meshletIdx] };
+			if (m_UseMeshletCulling && IsMeshletCulled(meshlet, frustum, cameraPosition))
+				continue;
+
+			if (m_UseOcclusionCulling && IsMeshletOccluded(meshlet, occlusionToClip))
+			{
+				if (pOccludedMeshlets)
+					pOccludedMeshlets->push_back(OccludedMeshlet{ instanceIdx, meshletIdx });
+				continue;
+			}
 
-			RenderTriangle(idx0, idx1, idx2, raster_Vertices);
+			AssembleMeshlet(mesh, meshlet);
 		}
+	}
 		break;
 	}
-	//@END
-	//Update SDL Surface
-	SDL_UnlockSurface(m_pBackBuffer);
-	SDL_BlitSurface(m_pBackBuffer, 0, m_pFrontBuffer, 0);
-	SDL_UpdateWindowSurface(m_pWindow);
 }
 
-void Renderer::VertexTransformationFunction() 
+void dae::Renderer::BeginInstance(Mesh& mesh, const MeshInstance& instance, uint32_t instanceIdx, bool isLazy)
+{
+	//The vertex data is shared, every instance gets transformed into mesh.vertices_out again
+	m_TransformedInstanceIdx = instanceIdx;
+	m_IsTransformLazy = isLazy || m_UseLazyVertexTransform;
+	m_WorldMatrix = instance.worldMatrix;
+	m_WorldViewProjectionMatrix = m_WorldMatrix * m_Camera.viewMatrix * m_Camera.projectionMatrix;
+	m_InstanceTint = instance.tint;
+
+	if (m_IsTransformLazy)
+	{
+		//Vertices get transformed on demand during triangle assembly
+		BeginLazyVertexTransform(mesh);
+	}
+	else
+	{
+		VertexTransformationFunction(mesh);
+
+		m_RasterVertices.clear();
+		m_RasterVertices.reserve(mesh.vertices_out.size());
+		for (Vertex_Out& vertex : mesh.vertices_out)
+		{
+			m_RasterVertices.push_back(Vector2{ (vertex.position.x + 1) * 0.5f * m_Width, (1 - vertex.position.y) * 0.5f * m_Height });
+		}
+	}
+}
+
+void dae::Renderer::AssembleMeshlet(Mesh& mesh, const Meshlet& meshlet)
+{
+	const int endIndex{ static_cast<int>(meshlet.firstIndex + meshlet.nrIndices) };
+	for (int i = static_cast<int>(meshlet.firstIndex); i + 2 < endIndex; i += 3)
+	{
+		int idx0{ i };
+		int idx1{ i + 1 };
+		int idx2{ i + 2 };
+
+		AssembleTriangle(mesh, idx0, idx1, idx2);
+	}
+}
+
+bool dae::Renderer::IsInstanceOccluded(const MeshInstance& instance) const
+{
+	if (!m_UseOcclusionCulling)
+		return false;
+
+	const BoundingBox& bounds{ m_Scene.GetMeshBounds(instance.meshIdx) };
+	return m_DepthPyramid.IsBoxOccluded(instance.worldMatrix * m_DepthPyramid.viewProjection, bounds.min, bounds.max);
+}
+
+bool dae::Renderer::IsMeshletOccluded(const Meshlet& meshlet, const Matrix& toClip) const
+{
+	const Vector3 extent{ meshlet.radius, meshlet.radius, meshlet.radius };
+	return m_DepthPyramid.IsBoxOccluded(toClip, meshlet.center - extent, meshlet.center + extent);
+}
+
+void Renderer::VertexTransformationFunction(Mesh& mesh) 
 {
 	//Todo > W1 Projection Stage
-	m_MeshWorld.vertices_out.clear();
-	m_MeshWorld.vertices_out.reserve(m_MeshWorld.vertices.size());
-	Matrix worldViewProjectMatrix = m_MeshWorld.worldMatrix * m_Camera.viewMatrix * m_Camera.projectionMatrix;
+	mesh.vertices_out.clear();
+	mesh.vertices_out.reserve(mesh.vertices.size());
+	m_ClipPositions.clear();
+	m_ClipPositions.reserve(mesh.vertices.size());
+	const Matrix& worldViewProjectMatrix{ m_WorldViewProjectionMatrix };
+
+	if (m_CurrentVertexLayout == VertexLayout::StructOfArrays)
+	{
+		TransformVertexStreams(mesh.vertexStreams, worldViewProjectMatrix, m_WorldMatrix, mesh.vertices_out, m_ClipPositions);
+		return;
+	}
 
-	for (Vertex currentVertex : m_MeshWorld.vertices)
+	for (Vertex currentVertex : mesh.vertices)
 	{
 		Vertex_Out vertexOut{ {}, currentVertex.color, currentVertex.uv, currentVertex.normal, currentVertex.tangent, currentVertex.viewDirection};
 		vertexOut.position = worldViewProjectMatrix.TransformPoint({currentVertex.position, 1});
+		m_ClipPositions.push_back(vertexOut.position);
 		currentVertex.position.x = currentVertex.position.x / (m_Camera.fov * m_AspectRatio);// / currentVertex.position.z;
 		currentVertex.position.y = currentVertex.position.y / m_Camera.fov; // / currentVertex.position.z;
 		
@@ -137,23 +438,83 @@ void Renderer::VertexTransformationFunction()
 		vertexOut.position.y /= vertexOut.position.w;
 		vertexOut.position.z /= vertexOut.position.w;
 
-		vertexOut.normal = m_MeshWorld.worldMatrix.TransformVector(vertexOut.normal).Normalized();
+		vertexOut.normal = m_WorldMatrix.TransformVector(vertexOut.normal).Normalized();
 		vertexOut.viewDirection = Vector3{ vertexOut.position.x, vertexOut.position.y, vertexOut.position.z }.Normalized();
-		m_MeshWorld.vertices_out.push_back(vertexOut);
+		mesh.vertices_out.push_back(vertexOut);
+	}
+}
+
+void dae::Renderer::BeginLazyVertexTransform(Mesh& mesh)
+{
+	const size_t nrVertices{ mesh.vertices.size() };
+
+	//Drops the clipped vertices of last frame, the rest gets overwritten when needed
+	mesh.vertices_out.resize(nrVertices);
+	m_ClipPositions.resize(nrVertices);
+	m_RasterVertices.resize(nrVertices);
+
+	m_PositionGenerations.resize(nrVertices);
+	m_AttributeGenerations.resize(nrVertices);
+
+	//On wrap around, old tags could match again
+	++m_VertexGeneration;
+	if (m_VertexGeneration == 0)
+	{
+		std::fill(m_PositionGenerations.begin(), m_PositionGenerations.end(), 0);
+		std::fill(m_AttributeGenerations.begin(), m_AttributeGenerations.end(), 0);
+		m_VertexGeneration = 1;
 	}
 }
 
+void dae::Renderer::TransformVertexPosition(Mesh& mesh, uint32_t vertexIdx)
+{
+	//Vertices made by clipping are complete already
+	if (vertexIdx >= m_PositionGenerations.size() || m_PositionGenerations[vertexIdx] == m_VertexGeneration)
+		return;
+	m_PositionGenerations[vertexIdx] = m_VertexGeneration;
+
+	//Same math as VertexTransformationFunction
+	Vertex_Out& vertexOut{ mesh.vertices_out[vertexIdx] };
+	vertexOut.position = m_WorldViewProjectionMatrix.TransformPoint({ mesh.vertices[vertexIdx].position, 1 });
+	m_ClipPositions[vertexIdx] = vertexOut.position;
+	vertexOut.position.x /= vertexOut.position.w;
+	vertexOut.position.y /= vertexOut.position.w;
+	vertexOut.position.z /= vertexOut.position.w;
+
+	m_RasterVertices[vertexIdx] = Vector2{ (vertexOut.position.x + 1) * 0.5f * m_Width, (1 - vertexOut.position.y) * 0.5f * m_Height };
+}
+
+void dae::Renderer::TransformVertexAttributes(Mesh& mesh, uint32_t vertexIdx)
+{
+	if (vertexIdx >= m_AttributeGenerations.size() || m_AttributeGenerations[vertexIdx] == m_VertexGeneration)
+		return;
+	m_AttributeGenerations[vertexIdx] = m_VertexGeneration;
+
+	const Vertex& vertex{ mesh.vertices[vertexIdx] };
+	Vertex_Out& vertexOut{ mesh.vertices_out[vertexIdx] };
+	vertexOut.color = vertex.color;
+	vertexOut.uv = vertex.uv;
+	vertexOut.normal = m_WorldMatrix.TransformVector(vertex.normal).Normalized();
+	vertexOut.tangent = vertex.tangent;
+	vertexOut.viewDirection = Vector3{ vertexOut.position.x, vertexOut.position.y, vertexOut.position.z }.Normalized();
+}
+
 void Renderer::InitializeMesh()
 {
+	Mesh mesh{};
 
 #ifdef CUSTOM_MESH
-	//Utils::ParseOBJ("Resources/tuktuk.obj", m_MeshWorld.vertices, m_MeshWorld.indices);
-	Utils::ParseOBJ("Resources/vehicle.obj", m_MeshWorld.vertices, m_MeshWorld.indices);
+	//Utils::ParseOBJ("Resources/tuktuk.obj", mesh.vertices, mesh.indices);
+	Utils::ParseOBJ("Resources/vehicle.obj", mesh.vertices, mesh.indices);
+#ifdef OPTIMIZE_MESH
+	const float acmrBefore{ Utils::CalculateACMR(mesh.indices, mesh.vertices.size(), Utils::VERTEX_CACHE_SIZE) };
+	Utils::OptimizeMesh(mesh.vertices, mesh.indices);
+#endif
 #else
 
 #ifdef TRIANGLE_STRIP
 
-		m_MeshWorld =
+		mesh =
 		Mesh
 		{
 			{
@@ -202,7 +563,7 @@ void Renderer::InitializeMesh()
 			PrimitiveTopology::TriangleStrip
 		};
 #else
-	m_MeshWorld =
+	mesh =
 	Mesh
 	{
 		{
@@ -261,272 +622,1263 @@ void Renderer::InitializeMesh()
 	const Vector3 rotation{ };
 	const Vector3 scale{ Vector3{ 1, 1, 1 } };
 	//const Vector3 scale{ Vector3{ 0.5f, 0.5f, 0.5f } };
-	m_MeshWorld.worldMatrix = Matrix::CreateScale(scale) * Matrix::CreateRotation(rotation) * Matrix::CreateTranslation(position);
-}
-
-bool dae::Renderer::IsInsideFrustrum(const Vector4& position)
-{
-	return position.x < -1.f || position.x > 1.f || position.y > 1.f || position.y < -1.f || position.z > 1.0f || position.z < 0.f;
-}
-
-void dae::Renderer::RenderTriangle(int idx0, int idx1, int idx2, std::vector<Vector2>& screenVertices)
-{
-
-	if (IsInsideFrustrum(m_MeshWorld.vertices_out[m_MeshWorld.indices[idx0]].position) ||
-		IsInsideFrustrum(m_MeshWorld.vertices_out[m_MeshWorld.indices[idx1]].position) ||
-		IsInsideFrustrum(m_MeshWorld.vertices_out[m_MeshWorld.indices[idx2]].position))
-		return;
-
-	Vector2 p0{ screenVertices[m_MeshWorld.indices[idx0]] };
-	Vector2 p1{ screenVertices[m_MeshWorld.indices[idx1]] };
-	Vector2 p2{ screenVertices[m_MeshWorld.indices[idx2]] };
+	const Matrix worldMatrix{ Matrix::CreateScale(scale) * Matrix::CreateRotation(rotation) * Matrix::CreateTranslation(position) };
 
-	Vector2 e0{ p1 - p0 };
-	Vector2 e1{ p2 - p1 };
-	Vector2 e2{ p0 - p2 };
+	BuildVertexStreams(mesh.vertices, mesh.vertexStreams);
 
+	//Triangle lists get drawn per meshlet, from one of their levels of detail
+	if (mesh.primitiveTopology == PrimitiveTopology::TriangleList)
+		Utils::BuildLods(mesh.vertices, mesh.indices, mesh.meshlets, mesh.lods);
 
-	float triangleArea = Vector2::Cross(e0, e1);
-
-	Vector2 Min{ Vector2::Min(p0,Vector2::Min(p1,p2)) };
-	Vector2 Max{ Vector2::Max(p0,Vector2::Max(p1,p2)) };
+#if defined(CUSTOM_MESH) && defined(OPTIMIZE_MESH)
+	//Of the full detail level in the order it gets drawn in, meshlet by meshlet
+	const Meshlet& lastMeshlet{ mesh.meshlets[mesh.lods[0].nrMeshlets - 1] };
+	const std::vector<uint32_t> drawnIndices{ mesh.indices.begin(), mesh.indices.begin() + lastMeshlet.firstIndex + lastMeshlet.nrIndices };
+	const float acmrAfter{ Utils::CalculateACMR(drawnIndices, mesh.vertices.size(), Utils::VERTEX_CACHE_SIZE) };
+	std::cout << "ACMR (cache size " << Utils::VERTEX_CACHE_SIZE << "): " << acmrBefore << " -> " << acmrAfter << std::endl;
+#endif
 
-	const int startX{ std::clamp(static_cast<int>(Min.x) - 1, 0, m_Width) };
-	const int startY{ std::clamp(static_cast<int>(Min.y) - 1, 0, m_Height) };
-	const int endX{ std::clamp(static_cast<int>(Max.x) + 1, 0, m_Width) };
-	const int endY{ std::clamp(static_cast<int>(Max.y) + 1, 0, m_Height) };
+	const uint32_t meshIdx{ m_Scene.AddMesh(std::move(mesh)) };
 
-	//RENDER LOGIC
-	for (int px{ startX }; px < endX; ++px)
+#ifdef MESH_GRID
+	std::vector<Matrix> worldMatrices{};
+	std::vector<ColorRGB> tints{};
+	for (int z{}; z < MESH_GRID; ++z)
 	{
-		for (int py{ startY }; py < endY; ++py)
+		for (int x{}; x < MESH_GRID; ++x)
 		{
+			const Vector3 offset{ (x - (MESH_GRID - 1) * 0.5f) * MESH_GRID_SPACING, 0, z * MESH_GRID_SPACING };
+			worldMatrices.push_back(worldMatrix * Matrix::CreateTranslation(offset));
+			tints.push_back(ColorRGB{ 1.f - 0.5f * x / MESH_GRID, 1.f, 1.f - 0.5f * z / MESH_GRID });
+		}
+	}
+	m_Scene.AddInstances(meshIdx, worldMatrices, tints);
+#else
+	m_Scene.AddInstance(meshIdx, worldMatrix);
+#endif
+}
 
+void dae::Renderer::InitializeLights()
+{
+#ifdef NIGHT_LIGHTS
+	m_Scene.AddLight(Light::CreateDirectional(Vector3{ .577f, -.577f, .577f }, 1.f, ColorRGB{ 0.1f, 0.12f, 0.2f }));
 
-			Vector2 currentPixel{ static_cast<float>(px), static_cast<float>(py) };
-			float currPixMin0Crossv0 = Vector2::Cross(e0, currentPixel - p0);
-			float currPixMin1Crossv1 = Vector2::Cross(e1, currentPixel - p1);
-			float currPixMin2Crossv2 = Vector2::Cross(e2, currentPixel - p2);
-
-			if (!(currPixMin0Crossv0 > 0 && currPixMin1Crossv1 > 0 && currPixMin2Crossv2 > 0))
-				continue;
+	BoundingBox sceneBounds{};
+	for (uint32_t instanceIdx{}; instanceIdx < m_Scene.GetNrInstances(); ++instanceIdx)
+	{
+		const MeshInstance& instance{ m_Scene.GetInstance(instanceIdx) };
+		sceneBounds.Grow(m_Scene.GetMeshBounds(instance.meshIdx).Transformed(instance.worldMatrix));
+	}
+	const Vector3 size{ sceneBounds.max - sceneBounds.min };
+
+	//Square grid over the ground, lamps shine down from above the scene, the colored point lights sit halfway up
+	static const ColorRGB pointLightColors[]{ { 1.f, .2f, .1f }, { 1.f, .6f, .1f }, { .2f, 1.f, .3f }, { .1f, .8f, 1.f }, { .3f, .3f, 1.f }, { 1.f, .2f, .9f } };
+	const int nrLightsPerRow{ static_cast<int>(std::ceil(std::sqrt(static_cast<float>(NIGHT_LIGHTS)))) };
+	const float spacing{ std::max(size.x, size.z) / nrLightsPerRow };
+	const float lampHeight{ sceneBounds.max.y + size.y * 0.5f };
+	for (int lightIdx{}; lightIdx < NIGHT_LIGHTS; ++lightIdx)
+	{
+		const float x{ sceneBounds.min.x + (lightIdx % nrLightsPerRow + 0.5f) / nrLightsPerRow * size.x };
+		const float z{ sceneBounds.min.z + (lightIdx / nrLightsPerRow + 0.5f) / nrLightsPerRow * size.z };
+		if (lightIdx % 2 == 0)
+			m_Scene.AddLight(Light::CreateSpot(Vector3{ x, lampHeight, z }, Vector3{ 0.f, -1.f, 0.f }, 20.f, 35.f, (lampHeight - sceneBounds.min.y) * 1.5f, 3.f, ColorRGB{ 1.f, .85f, .6f }));
+		else
+			m_Scene.AddLight(Light::CreatePoint(Vector3{ x, sceneBounds.GetCenter().y, z }, spacing * 2.f, 3.f, pointLightColors[lightIdx / 2 % std::size(pointLightColors)]));
+	}
+#else
+	m_Scene.AddLight(Light::CreateDirectional(Vector3{ .577f, -.577f, .577f }, 7.f));
+#endif
+}
 
-			float weight0 = currPixMin1Crossv1 / triangleArea;
-			float weight1 = currPixMin2Crossv2 / triangleArea;
-			float weight2 = currPixMin0Crossv0 / triangleArea;
+void dae::Renderer::CullLights(const Matrix& viewProjectionMatrix)
+{
+	const std::span<const Light> lights{ m_Scene.GetLights() };
+	const Frustum frustum{ Frustum::FromMatrix(viewProjectionMatrix) };
 
-			const float depthZV0{ (m_MeshWorld.vertices_out[m_MeshWorld.indices[idx0]].position.z) };
-			const float depthZV1{ (m_MeshWorld.vertices_out[m_MeshWorld.indices[idx1]].position.z) };
-			const float depthZV2{ (m_MeshWorld.vertices_out[m_MeshWorld.indices[idx2]].position.z) };
-			// Calculate the Z depth at this pixel
-			const float interpolatedZDepth
+	m_ShadeConstants.pLights = lights.data();
+	m_ShadeConstants.glossiness = GLOSSINESS;
+	if (m_SpecularPowerTable.glossiness != GLOSSINESS)
+	{
+		m_SpecularPowerTable.Build(GLOSSINESS);
+	}
+	m_ShadeConstants.pSpecularTable = m_UseSpecularTable ? &m_SpecularPowerTable : nullptr;
+	//Pixel coordinates to NDC, then back through the view projection
+	const Matrix screenToNdc{
+		Vector4{ 2.f / m_Width, 0.f, 0.f, 0.f },
+		Vector4{ 0.f, -2.f / m_Height, 0.f, 0.f },
+		Vector4{ 0.f, 0.f, 1.f, 0.f },
+		Vector4{ -1.f, 1.f, 0.f, 1.f } };
+	m_ShadeConstants.screenToWorld = screenToNdc * Matrix::Inverse(viewProjectionMatrix);
+
+	//Tiles every light can reach, directional lights reach all of them
+	m_LightTileRects.clear();
+	for (uint32_t lightIdx{}; lightIdx < lights.size(); ++lightIdx)
+	{
+		const Light& light{ lights[lightIdx] };
+		LightTileRect rect{ lightIdx, 0, 0, m_NrLightTilesX - 1, m_NrLightTilesY - 1 };
+		if (light.type != LightType::Directional)
+		{
+			//Sphere around the lit volume. Narrow spot cones fit in the sphere through their tip and rim, wide ones in the one around their rim
+			Vector3 center{ light.position };
+			float radius{ light.range };
+			if (light.type == LightType::Spot && light.cosOuterCone > 0.f)
 			{
-				1.0f /
-					(weight0 / depthZV0 +
-					weight1 / depthZV1 +
-					weight2 / depthZV2)
-			};
-
-			int pixelIdx = px + (py * m_Width);
-			if (m_pDepthBufferPixels[pixelIdx] < interpolatedZDepth)
+				const float sinOuterCone{ sqrtf(1.f - light.cosOuterCone * light.cosOuterCone) };
+				const bool isNarrow{ light.cosOuterCone > sinOuterCone };
+				radius = isNarrow ? light.range * 0.5f / light.cosOuterCone : light.range * sinOuterCone;
+				center += light.direction * (isNarrow ? radius : light.range * light.cosOuterCone);
+			}
+			if (frustum.IsSphereOutside(center, radius))
 				continue;
 
-			m_pDepthBufferPixels[pixelIdx] = interpolatedZDepth;
+			//Screen rectangle of the box around the sphere, all of the screen once the box reaches behind the near plane
+			float minX{ FLT_MAX }, minY{ FLT_MAX }, maxX{ -FLT_MAX }, maxY{ -FLT_MAX };
+			bool isInFront{ true };
+			for (int corner{}; corner < 8 && isInFront; ++corner)
+			{
+				const Vector3 offset{ corner & 1 ? radius : -radius, corner & 2 ? radius : -radius, corner & 4 ? radius : -radius };
+				const Vector4 clip{ viewProjectionMatrix.TransformPoint(Vector4{ center + offset, 1.f }) };
+				isInFront = clip.w >= m_Camera.nearPlane;
+
+				const float x{ (clip.x / clip.w + 1) * 0.5f * m_Width };
+				const float y{ (1 - clip.y / clip.w) * 0.5f * m_Height };
+				minX = std::min(minX, x);
+				minY = std::min(minY, y);
+				maxX = std::max(maxX, x);
+				maxY = std::max(maxY, y);
+			}
 
-			switch (m_CurrentRendeMode)
+			if (isInFront)
 			{
-			case dae::RenderMode::Texture:
+				if (maxX < 0.f || maxY < 0.f || minX >= m_Width || minY >= m_Height)
+					continue;
+				rect.firstX = std::max(static_cast<int>(minX), 0) / LIGHT_TILE_SIZE;
+				rect.firstY = std::max(static_cast<int>(minY), 0) / LIGHT_TILE_SIZE;
+				rect.lastX = std::min(static_cast<int>(maxX), m_Width - 1) / LIGHT_TILE_SIZE;
+				rect.lastY = std::min(static_cast<int>(maxY), m_Height - 1) / LIGHT_TILE_SIZE;
+			}
+		}
+		m_LightTileRects.push_back(rect);
+	}
+
+	//Count per tile, turn the counts into offsets, then fill in the indices in light order
+	const size_t nrTiles{ static_cast<size_t>(m_NrLightTilesX) * m_NrLightTilesY };
+	m_TileLightOffsets.assign(nrTiles + 1, 0);
+	for (const LightTileRect& rect : m_LightTileRects)
+	{
+		for (int tileY{ rect.firstY }; tileY <= rect.lastY; ++tileY)
+		{
+			for (int tileX{ rect.firstX }; tileX <= rect.lastX; ++tileX)
 			{
-				//W Depth
-				const float depthWV0{ (m_MeshWorld.vertices_out[m_MeshWorld.indices[idx0]].position.w) };
-				const float depthWV1{ (m_MeshWorld.vertices_out[m_MeshWorld.indices[idx1]].position.w) };
-				const float depthWV2{ (m_MeshWorld.vertices_out[m_MeshWorld.indices[idx2]].position.w) };
+				++m_TileLightOffsets[tileX + tileY * m_NrLightTilesX + 1];
+			}
+		}
+	}
+	for (size_t tileIdx{}; tileIdx < nrTiles; ++tileIdx)
+	{
+		m_TileLightOffsets[tileIdx + 1] += m_TileLightOffsets[tileIdx];
+	}
 
+	m_TileLightIndices.resize(m_TileLightOffsets[nrTiles]);
+	m_TileLightCursors.assign(m_TileLightOffsets.begin(), m_TileLightOffsets.end() - 1);
+	for (const LightTileRect& rect : m_LightTileRects)
+	{
+		for (int tileY{ rect.firstY }; tileY <= rect.lastY; ++tileY)
+		{
+			for (int tileX{ rect.firstX }; tileX <= rect.lastX; ++tileX)
+			{
+				m_TileLightIndices[m_TileLightCursors[tileX + tileY * m_NrLightTilesX]++] = rect.lightIdx;
+			}
+		}
+	}
+}
 
-				// Calculate the W depth at this pixel
-				const float interpolatedWDepth
-				{
-					1.0f /
-						(weight0 / depthWV0 +
-						weight1 / depthWV1 +
-						weight2 / depthWV2)
-				};
+std::span<const uint32_t> dae::Renderer::GetTileLights(int px, int py) const
+{
+	const int tileIdx{ px / LIGHT_TILE_SIZE + py / LIGHT_TILE_SIZE * m_NrLightTilesX };
+	return std::span<const uint32_t>{ m_TileLightIndices.data() + m_TileLightOffsets[tileIdx], m_TileLightIndices.data() + m_TileLightOffsets[tileIdx + 1] };
+}
 
-				Vertex_Out interpolatedVertex{};
+Vector3 dae::Renderer::GetWorldPosition(int px, int py, float depth) const
+{
+	const Vector4 position{ m_ShadeConstants.screenToWorld.TransformPoint(Vector4{ static_cast<float>(px) + 0.5f, static_cast<float>(py) + 0.5f, depth, 1.f }) };
+	return Vector3{ position.x / position.w, position.y / position.w, position.z / position.w };
+}
 
-				//UV interpolate
-				Vector2 uvInterpolate1{ weight0 * (m_MeshWorld.vertices_out[m_MeshWorld.indices[idx0]].uv / depthWV0) };
-				Vector2 uvInterpolate2{ weight1 * (m_MeshWorld.vertices_out[m_MeshWorld.indices[idx1]].uv / depthWV1) };
-				Vector2 uvInterpolate3{ weight2 * (m_MeshWorld.vertices_out[m_MeshWorld.indices[idx2]].uv / depthWV2) };
+uint32_t dae::Renderer::SelectLod(const Mesh& mesh, const MeshInstance& instance) const
+{
+	if (!m_UseLodSelection)
+		return 0;
 
-				Vector2 uvInterpolateTotal{ uvInterpolate1 + uvInterpolate2 + uvInterpolate3 };
+	//Bounding sphere of the instance, scaled by its largest axis
+	const BoundingBox& bounds{ m_Scene.GetMeshBounds(instance.meshIdx) };
+	const float scale{ std::max(instance.worldMatrix.GetAxisX().Magnitude(), std::max(instance.worldMatrix.GetAxisY().Magnitude(), instance.worldMatrix.GetAxisZ().Magnitude())) };
+	const Vector3 center{ instance.worldMatrix.TransformPoint(bounds.GetCenter()) };
+	const float radius{ (bounds.max - bounds.min).Magnitude() * 0.5f * scale };
 
-				Vector2 uvInterpolated{ interpolatedWDepth * uvInterpolateTotal };
+	const float distance{ (center - m_Camera.origin).Magnitude() - radius };
+	if (distance <= m_Camera.nearPlane)
+		return 0;
 
-				interpolatedVertex.uv = uvInterpolated;
+	//Projected size of one world unit at that distance
+	const float pixelsPerUnit{ m_Height * 0.5f / (distance * m_Camera.fov) };
 
-				//Normal interpolate
-				Vector3 normalInterpolate1{ weight0 * (m_MeshWorld.vertices_out[m_MeshWorld.indices[idx0]].normal / depthWV0) };
-				Vector3 normalInterpolate2{ weight1 * (m_MeshWorld.vertices_out[m_MeshWorld.indices[idx1]].normal / depthWV1) };
-				Vector3 normalInterpolate3{ weight2 * (m_MeshWorld.vertices_out[m_MeshWorld.indices[idx2]].normal / depthWV2) };
+	uint32_t lodIdx{};
+	while (lodIdx + 1 < mesh.lods.size() && mesh.lods[lodIdx + 1].error * scale * pixelsPerUnit <= LOD_MAX_PIXEL_ERROR)
+	{
+		++lodIdx;
+	}
+	return lodIdx;
+}
 
-				Vector3 normalInterpolateTotal{ normalInterpolate1 + normalInterpolate2 + normalInterpolate3 };
-				Vector3 normalInterpolated{ interpolatedWDepth * normalInterpolateTotal };
+bool dae::Renderer::IsMeshletCulled(const Meshlet& meshlet, const Frustum& frustum, const Vector3& cameraPosition) const
+{
+	if (frustum.IsSphereOutside(meshlet.center, meshlet.radius))
+		return true;
 
-				interpolatedVertex.normal = normalInterpolated.Normalized();
+	//Cone culling assumes the world matrix doesn't mirror
+	switch (m_CurrentCullMode)
+	{
+	case CullMode::Back:
+		return IsConeBackFacing(meshlet.center, meshlet.radius, meshlet.coneAxis, meshlet.coneCutoff + CONE_SNAP_MARGIN, cameraPosition);
+	case CullMode::Front:
+		return IsConeBackFacing(meshlet.center, meshlet.radius, -meshlet.coneAxis, meshlet.coneCutoff + CONE_SNAP_MARGIN, cameraPosition);
+	default:
+		return false;
+	}
+}
 
-				//Tangent interpolate
-				Vector3 tangentInterpolate1{ weight0 * (m_MeshWorld.vertices_out[m_MeshWorld.indices[idx0]].tangent / depthWV0) };
-				Vector3 tangentInterpolate2{ weight1 * (m_MeshWorld.vertices_out[m_MeshWorld.indices[idx1]].tangent / depthWV1) };
-				Vector3 tangentInterpolate3{ weight2 * (m_MeshWorld.vertices_out[m_MeshWorld.indices[idx2]].tangent / depthWV2) };
+uint32_t dae::Renderer::CalculateOutCode(const Vector4& clipPosition) const
+{
+	const float x{ clipPosition.x };
+	const float y{ clipPosition.y };
+	const float z{ clipPosition.z };
+	const float w{ clipPosition.w };
+
+	uint32_t outCode{};
+	if (!(z >= 0.f)) outCode |= CLIP_NEAR;
+	if (z > w) outCode |= CLIP_FAR;
+	if (x < -w) outCode |= CLIP_LEFT;
+	if (x > w) outCode |= CLIP_RIGHT;
+	if (y < -w) outCode |= CLIP_BOTTOM;
+	if (y > w) outCode |= CLIP_TOP;
+	if (x < -GUARD_BAND * w) outCode |= CLIP_GUARD_LEFT;
+	if (x > GUARD_BAND * w) outCode |= CLIP_GUARD_RIGHT;
+	if (y < -GUARD_BAND * w) outCode |= CLIP_GUARD_BOTTOM;
+	if (y > GUARD_BAND * w) outCode |= CLIP_GUARD_TOP;
+	return outCode;
+}
 
-				Vector3 tangentInterpolateTotal{ tangentInterpolate1 + tangentInterpolate2 + tangentInterpolate3 };
-				Vector3 tangentInterpolated{ interpolatedWDepth * tangentInterpolateTotal };
+void dae::Renderer::AssembleTriangle(Mesh& mesh, int idx0, int idx1, int idx2)
+{
+	const Triangle triangle{ mesh.indices[idx0], mesh.indices[idx1], mesh.indices[idx2] };
 
-				interpolatedVertex.tangent = tangentInterpolated.Normalized();
+	//Culling only needs the positions
+	if (m_IsTransformLazy)
+	{
+		TransformVertexPosition(mesh, triangle.v0);
+		TransformVertexPosition(mesh, triangle.v1);
+		TransformVertexPosition(mesh, triangle.v2);
+	}
 
-				//viewdirection interpolate
-				Vector3 viewDirectionInterpolate1{ weight0 * (m_MeshWorld.vertices_out[m_MeshWorld.indices[idx0]].viewDirection / depthWV0) };
-				Vector3 viewDirectionInterpolate2{ weight1 * (m_MeshWorld.vertices_out[m_MeshWorld.indices[idx1]].viewDirection / depthWV1) };
-				Vector3 viewDirectionInterpolate3{ weight2 * (m_MeshWorld.vertices_out[m_MeshWorld.indices[idx2]].viewDirection / depthWV2) };
+	const uint32_t outCode0{ CalculateOutCode(m_ClipPositions[triangle.v0]) };
+	const uint32_t outCode1{ CalculateOutCode(m_ClipPositions[triangle.v1]) };
+	const uint32_t outCode2{ CalculateOutCode(m_ClipPositions[triangle.v2]) };
 
-				Vector3 viewDirectionInterpolateTotal{ viewDirectionInterpolate1 + viewDirectionInterpolate2 + viewDirectionInterpolate3 };
-				Vector3 viewDirectionInterpolated{ interpolatedWDepth * viewDirectionInterpolateTotal };
+	//All vertices outside the same frustum plane
+	if ((outCode0 & outCode1 & outCode2) != 0)
+		return;
 
-				interpolatedVertex.viewDirection = viewDirectionInterpolated.Normalized();
+	//Only near/far and the guard band need real clipping, the rest is handled by the bounding box clamp
+	const uint32_t clipPlanes{ (outCode0 | outCode1 | outCode2) & CLIP_PLANES };
+	if (clipPlanes == 0)
+	{
+		SubmitTriangle(mesh, triangle);
+		return;
+	}
 
+	ClipTriangle(mesh, triangle, clipPlanes);
+}
 
-				ColorRGB finalColor{ PixelShading(interpolatedVertex) };
+static float GetPlaneDistance(const Vector4& clipPosition, uint32_t plane)
+{
+	switch (plane)
+	{
+	case CLIP_NEAR:
+		return clipPosition.z;
+	case CLIP_FAR:
+		return clipPosition.w - clipPosition.z;
+	case CLIP_GUARD_LEFT:
+		return clipPosition.x + GUARD_BAND * clipPosition.w;
+	case CLIP_GUARD_RIGHT:
+		return GUARD_BAND * clipPosition.w - clipPosition.x;
+	case CLIP_GUARD_BOTTOM:
+		return clipPosition.y + GUARD_BAND * clipPosition.w;
+	case CLIP_GUARD_TOP:
+		return GUARD_BAND * clipPosition.w - clipPosition.y;
+	default:
+		return 0.f;
+	}
+}
 
-				finalColor.MaxToOne();
+static Vertex_Out LerpVertex(const Vertex_Out& v0, const Vertex_Out& v1, float factor)
+{
+	Vertex_Out vertex{};
+	vertex.position = v0.position + (v1.position - v0.position) * factor;
+	vertex.color = ColorRGB::Lerp(v0.color, v1.color, factor);
+	vertex.uv = v0.uv + (v1.uv - v0.uv) * factor;
+	vertex.normal = v0.normal + (v1.normal - v0.normal) * factor;
+	vertex.tangent = v0.tangent + (v1.tangent - v0.tangent) * factor;
+	vertex.viewDirection = v0.viewDirection + (v1.viewDirection - v0.viewDirection) * factor;
+	return vertex;
+}
 
+void dae::Renderer::ClipTriangle(Mesh& mesh, const Triangle& triangle, uint32_t clipPlanes)
+{
+	if (m_IsTransformLazy)
+	{
+		TransformVertexAttributes(mesh, triangle.v0);
+		TransformVertexAttributes(mesh, triangle.v1);
+		TransformVertexAttributes(mesh, triangle.v2);
+	}
 
-				//Update Color in Buffer
-				m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-					static_cast<uint8_t>(finalColor.r * 255),
-					static_cast<uint8_t>(finalColor.g * 255),
-					static_cast<uint8_t>(finalColor.b * 255));
+	//Every plane can add one vertex
+	constexpr int maxPolygonSize{ 3 + 6 };
+	Vertex_Out polygons[2][maxPolygonSize]{};
+	int polygonSize{ 3 };
 
-			}
-			break;
-			case dae::RenderMode::DepthBuffer:
-			{
-				float depthColor = Utils::Remap(interpolatedZDepth, 0.985f, 1.f);
+	const uint32_t vertexIndices[3]{ triangle.v0, triangle.v1, triangle.v2 };
+	for (int i{}; i < 3; ++i)
+	{
+		//The undivided position, attributes are linear in clip space and w can be 0 or below
+		Vertex_Out& vertex{ polygons[0][i] };
+		vertex = mesh.vertices_out[vertexIndices[i]];
+		vertex.position = m_ClipPositions[vertexIndices[i]];
+	}
 
+	//Sutherland-Hodgman, one plane at a time
+	int current{};
+	for (uint32_t plane{ CLIP_NEAR }; plane <= CLIP_GUARD_TOP && polygonSize >= 3; plane <<= 1)
+	{
+		if ((clipPlanes & plane) == 0)
+			continue;
 
-				ColorRGB finalColor{ depthColor, depthColor, depthColor };
+		const Vertex_Out* pInput{ polygons[current] };
+		Vertex_Out* pOutput{ polygons[1 - current] };
+		int outputSize{};
 
+		for (int i{}; i < polygonSize; ++i)
+		{
+			const Vertex_Out& start{ pInput[i] };
+			const Vertex_Out& end{ pInput[(i + 1) % polygonSize] };
+			const float startDistance{ GetPlaneDistance(start.position, plane) };
+			const float endDistance{ GetPlaneDistance(end.position, plane) };
 
-				//Update Color in Buffer
-				m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-					static_cast<uint8_t>(finalColor.r * 255),
-					static_cast<uint8_t>(finalColor.g * 255),
-					static_cast<uint8_t>(finalColor.b * 255));
-			}
-			break;
-			}
+			if (startDistance >= 0.f)
+				pOutput[outputSize++] = start;
 
+			if ((startDistance >= 0.f) != (endDistance >= 0.f))
+				pOutput[outputSize++] = LerpVertex(start, end, startDistance / (startDistance - endDistance));
 		}
-	}
-}
-
-ColorRGB dae::Renderer::PixelShading(const Vertex_Out& vertex_out)
-{
-	Vector3 pixelNormal{ vertex_out.normal };
-	//Normal calculations
-	if (m_ShowNormals)
-	{
-		Vector3 binormal = Vector3::Cross(vertex_out.normal, vertex_out.tangent);
-		Matrix tangentSpaceAxis = Matrix{ vertex_out.tangent, binormal, vertex_out.normal, Vector3::Zero};
-		auto sampledNormal{ m_pNormalTexture->Sample(vertex_out.uv) };
-		
-		sampledNormal = (2.f * sampledNormal) - ColorRGB{1.f, 1.f, 1.f}; // [0, 1] -> [-1, 1]
 
-		Vector3 sampledNormalVector{sampledNormal.r, sampledNormal.g, sampledNormal.b};
-		pixelNormal = tangentSpaceAxis.TransformVector(sampledNormalVector);
+		polygonSize = outputSize;
+		current = 1 - current;
 	}
 
-	Vector3 lightDirection = Vector3{ .577f, -.577f , .577f }.Normalized();
-	ColorRGB finalColor{ };
-	float lightIntensity{ 7.f };
-	float glossiness{ 25.f };
-	Vector3 ambient{ .025f, .025f, .025f };
-	float observedArea = std::max(Vector3::Dot(-lightDirection, pixelNormal), 0.f);
-
+	if (polygonSize < 3)
+		return;
 
-	switch (m_CurrentColorMode)
-	{
-	case dae::ColorMode::observedArea:
+	//Perspective divide the new polygon and fan it into triangles
+	const uint32_t firstVertex{ static_cast<uint32_t>(mesh.vertices_out.size()) };
+	for (int i{}; i < polygonSize; ++i)
 	{
-
-		finalColor += ColorRGB{ observedArea, observedArea, observedArea };
-		return finalColor;
-		break;
+		Vertex_Out vertex{ polygons[current][i] };
+		m_ClipPositions.push_back(vertex.position);
+		vertex.position.x /= vertex.position.w;
+		vertex.position.y /= vertex.position.w;
+		vertex.position.z /= vertex.position.w;
+
+		mesh.vertices_out.push_back(vertex);
+		m_RasterVertices.push_back(Vector2{ (vertex.position.x + 1) * 0.5f * m_Width, (1 - vertex.position.y) * 0.5f * m_Height });
 	}
-	case dae::ColorMode::Diffuse:
-	{
 
-		finalColor = Lambert(lightIntensity, m_MeshTexture->Sample(vertex_out.uv));
-		return finalColor * observedArea;
-		break;
-		}
-	case dae::ColorMode::Specular:
+	for (int i{ 1 }; i + 1 < polygonSize; ++i)
 	{
-		float exponent{m_pGlossTexture->Sample(vertex_out.uv).r * glossiness };
-		finalColor = Phong(1.0f, exponent, -lightDirection, vertex_out.viewDirection, pixelNormal) * m_pSpecularTexture->Sample(vertex_out.uv);
-		return finalColor;
-		break;
+		SubmitTriangle(mesh, Triangle{ firstVertex, firstVertex + i, firstVertex + i + 1 });
 	}
-	case dae::ColorMode::Combined:
-	{
-		float exponent{ m_pGlossTexture->Sample(vertex_out.uv).r * glossiness };
-		auto phong{ m_pSpecularTexture->Sample(vertex_out.uv) * Phong(1.0f, exponent, -lightDirection, vertex_out.viewDirection, pixelNormal) };
-		auto lambert{ Lambert(lightIntensity, m_MeshTexture->Sample(vertex_out.uv)) };
-		
-		return (lightIntensity * lambert + phong) * observedArea;
+}
+
+void dae::Renderer::SubmitTriangle(Mesh& mesh, const Triangle& triangle)
+{
+	const Vector2& p0{ m_RasterVertices[triangle.v0] };
+	const Vector2& p1{ m_RasterVertices[triangle.v1] };
+	const Vector2& p2{ m_RasterVertices[triangle.v2] };
 
+	//Zero area or no pixel centre inside the bounding box, nothing to draw
+	const int64_t signedArea{ CalculateSignedArea(p0, p1, p2) };
+	if (signedArea == 0 || IsMicroTriangle(p0, p1, p2))
+		return;
 
-		//const ColorRGB lambert{ 1.0f * m_MeshTexture->Sample(vertex_out.uv) / PI };
-		//
-		//const float phongExponent{ m_pGlossTexture->Sample(vertex_out.uv).r * glossiness };
-		//
-		//const ColorRGB specular{ m_pSpecularTexture->Sample(vertex_out.uv) * Phong(1.0f, phongExponent, -lightDirection, vertex_out.viewDirection, pixelNormal) };
-		//
-		//return (lightIntensity * lambert + specular) * observedArea;
+	const bool isFrontFacing{ signedArea > 0 };
+	switch (m_CurrentCullMode)
+	{
+	case CullMode::Back:
+		if (!isFrontFacing)
+			return;
+		break;
+	case CullMode::Front:
+		if (isFrontFacing)
+			return;
 		break;
-	}
 	default:
-		//finalColor += ambient;
-		return finalColor;
+		break;
 	}
 
-
+	//The rasterizer only handles clockwise triangles, flip the winding of the back faces that made it through
+	if (isFrontFacing)
+		SetupTriangle(mesh, triangle);
+	else
+		SetupTriangle(mesh, Triangle{ triangle.v0, triangle.v2, triangle.v1 });
 }
 
-ColorRGB Renderer::Lambert(float kd, const ColorRGB& cd)
+void dae::Renderer::SetupTriangle(Mesh& mesh, const Triangle& triangle)
 {
-	return (kd * cd) / static_cast<float>(M_PI);
-}
+	if (m_IsTransformLazy)
+	{
+		TransformVertexAttributes(mesh, triangle.v0);
+		TransformVertexAttributes(mesh, triangle.v1);
+		TransformVertexAttributes(mesh, triangle.v2);
+	}
 
-ColorRGB Renderer::Phong(float ks, float exp, const Vector3& l, const Vector3& v, const Vector3& n)
-{
+	//Fetch everything once
+	const Vertex_Out* vertices[3]{ &mesh.vertices_out[triangle.v0], &mesh.vertices_out[triangle.v1], &mesh.vertices_out[triangle.v2] };
 
-	Vector3 reflect{ Vector3::Reflect(l,n) };
-	float angle = std::max(Vector3::Dot(reflect, v), 0.f);
+	TriangleSetup& setup{ m_TriangleSetups.emplace_back() };
+	setup.tint = m_InstanceTint;
+	setup.screenPositions[0] = m_RasterVertices[triangle.v0];
+	setup.screenPositions[1] = m_RasterVertices[triangle.v1];
+	setup.screenPositions[2] = m_RasterVertices[triangle.v2];
 
-	float specularReflection = ks * powf(angle, exp);
+	for (int i{}; i < 3; ++i)
+	{
+		setup.invDepth[i] = 1.f / vertices[i]->position.z;
+	}
+	setup.minDepth = std::min(vertices[0]->position.z, std::min(vertices[1]->position.z, vertices[2]->position.z));
 
-	return ColorRGB{ specularReflection, specularReflection, specularReflection };
-}
+	//Gradients of the barycentric weights over the snapped triangle, relative to its first vertex
+	const Vector2 p0{ SnapToSubpixel(setup.screenPositions[0]) };
+	const Vector2 p1{ SnapToSubpixel(setup.screenPositions[1]) };
+	const Vector2 p2{ SnapToSubpixel(setup.screenPositions[2]) };
 
-bool Renderer::SaveBufferToImage() const
-{
-	return SDL_SaveBMP(m_pBackBuffer, "Rasterizer_ColorBuffer.bmp");
-}
+	const float invArea{ 1.f / Vector2::Cross(p1 - p0, p2 - p0) };
+	const float weightDx[3]{ (p1.y - p2.y) * invArea, (p2.y - p0.y) * invArea, (p0.y - p1.y) * invArea };
+	const float weightDy[3]{ (p2.x - p1.x) * invArea, (p0.x - p2.x) * invArea, (p1.x - p0.x) * invArea };
 
-void dae::Renderer::SwitchRenderMode()
-{
-	m_CurrentRendeMode = static_cast<RenderMode>((static_cast<int>(m_CurrentRendeMode) + 1)  % (static_cast<int>(RenderMode::DepthBuffer) + 1));
+	const auto createPlane = [&](float a0, float a1, float a2)
+		{
+			return AttributePlane{ a0, weightDx[0] * a0 + weightDx[1] * a1 + weightDx[2] * a2, weightDy[0] * a0 + weightDy[1] * a1 + weightDy[2] * a2 };
+		};
+
+	//Attributes divided by w
+	float invW[3]{};
+	for (int i{}; i < 3; ++i)
+	{
+		invW[i] = 1.f / vertices[i]->position.w;
+	}
+	setup.invW = createPlane(invW[0], invW[1], invW[2]);
+
+	for (int component{}; component < 2; ++component)
+	{
+		setup.uv[component] = createPlane(vertices[0]->uv[component] * invW[0], vertices[1]->uv[component] * invW[1], vertices[2]->uv[component] * invW[2]);
+	}
+
+	for (int component{}; component < 3; ++component)
+	{
+		setup.normal[component] = createPlane(vertices[0]->normal[component] * invW[0], vertices[1]->normal[component] * invW[1], vertices[2]->normal[component] * invW[2]);
+		setup.tangent[component] = createPlane(vertices[0]->tangent[component] * invW[0], vertices[1]->tangent[component] * invW[1], vertices[2]->tangent[component] * invW[2]);
+		setup.viewDirection[component] = createPlane(vertices[0]->viewDirection[component] * invW[0], vertices[1]->viewDirection[component] * invW[1], vertices[2]->viewDirection[component] * invW[2]);
+	}
+}
+
+void dae::Renderer::RasterizeTriangles(uint32_t firstTriangleIdx)
+{
+	BuildDrawOrder(firstTriangleIdx);
+
+	if (m_UseTiledRendering)
+	{
+		RenderTiled();
+		return;
+	}
+
+	RasterPass passes[2]{};
+	const int nrPasses{ GetRasterPasses(m_CurrentPipelineMode, passes) };
+
+	for (int passIdx{}; passIdx < nrPasses; ++passIdx)
+	{
+		for (uint32_t triangleIdx : m_DrawOrder)
+		{
+			RenderTriangle(m_TriangleSetups[triangleIdx], triangleIdx, 0, 0, m_Width, m_Height, passes[passIdx]);
+		}
+	}
+}
+
+void dae::Renderer::BuildDrawOrder(uint32_t firstTriangleIdx)
+{
+	const uint32_t nrTriangles{ static_cast<uint32_t>(m_TriangleSetups.size()) };
+	m_DrawOrder.clear();
+	for (uint32_t triangleIdx{ firstTriangleIdx }; triangleIdx < nrTriangles; ++triangleIdx)
+	{
+		m_DrawOrder.push_back(triangleIdx);
+	}
+
+	if (!m_UseDepthSorting)
+		return;
+
+	//NDC depth bunches up towards the far plane, the key is linear in view depth instead
+	const float nearPlane{ m_Camera.nearPlane };
+	const float farPlane{ m_Camera.farPlane };
+	m_DepthSortKeys.resize(nrTriangles);
+	for (uint32_t triangleIdx{ firstTriangleIdx }; triangleIdx < nrTriangles; ++triangleIdx)
+	{
+		const float viewDepth{ nearPlane * farPlane / (farPlane - m_TriangleSetups[triangleIdx].minDepth * (farPlane - nearPlane)) };
+		const float key{ std::clamp((viewDepth - nearPlane) / (farPlane - nearPlane), 0.f, 1.f) * DEPTH_SORT_KEY_RANGE };
+		m_DepthSortKeys[triangleIdx] = static_cast<uint16_t>(key);
+	}
+
+	Utils::RadixSortByKey(m_DrawOrder, m_DepthSortKeys, m_SortScratch);
+}
+
+void dae::Renderer::RenderTiled()
+{
+	for (std::vector<uint32_t>& bin : m_TileBins)
+	{
+		bin.clear();
+	}
+
+	//Binning, done in draw order so every tile still draws its triangles in the same order as the serial path
+	for (uint32_t triangleIdx : m_DrawOrder)
+	{
+		const TriangleSetup& setup{ m_TriangleSetups[triangleIdx] };
+		const Vector2& p0{ setup.screenPositions[0] };
+		const Vector2& p1{ setup.screenPositions[1] };
+		const Vector2& p2{ setup.screenPositions[2] };
+
+		//Same (padded) bounding box as RenderTriangle
+		const Vector2 Min{ Vector2::Min(p0,Vector2::Min(p1,p2)) };
+		const Vector2 Max{ Vector2::Max(p0,Vector2::Max(p1,p2)) };
+
+		const int startX{ std::clamp(static_cast<int>(Min.x) - 1, 0, m_Width - 1) };
+		const int startY{ std::clamp(static_cast<int>(Min.y) - 1, 0, m_Height - 1) };
+		const int endX{ std::clamp(static_cast<int>(Max.x) + 1, 0, m_Width - 1) };
+		const int endY{ std::clamp(static_cast<int>(Max.y) + 1, 0, m_Height - 1) };
+
+		for (int tileY{ startY / TILE_SIZE }; tileY <= endY / TILE_SIZE; ++tileY)
+		{
+			for (int tileX{ startX / TILE_SIZE }; tileX <= endX / TILE_SIZE; ++tileX)
+			{
+				m_TileBins[tileX + tileY * m_NrTilesX].push_back(triangleIdx);
+			}
+		}
+	}
+
+	RasterPass passes[2]{};
+	const int nrPasses{ GetRasterPasses(m_CurrentPipelineMode, passes) };
+
+	//Every tile owns its own slice of the color and depth buffer, no locking needed
+	//All passes of a tile run back to back, while its depth is still in cache
+	m_ThreadPool.ParallelFor(static_cast<uint32_t>(m_TileBins.size()), [&](uint32_t tileIdx)
+		{
+			const int minX{ static_cast<int>(tileIdx) % m_NrTilesX * TILE_SIZE };
+			const int minY{ static_cast<int>(tileIdx) / m_NrTilesX * TILE_SIZE };
+			const int maxX{ std::min(minX + TILE_SIZE, m_Width) };
+			const int maxY{ std::min(minY + TILE_SIZE, m_Height) };
+
+			for (int passIdx{}; passIdx < nrPasses; ++passIdx)
+			{
+				for (uint32_t triangleIdx : m_TileBins[tileIdx])
+				{
+					RenderTriangle(m_TriangleSetups[triangleIdx], triangleIdx, minX, minY, maxX, maxY, passes[passIdx]);
+				}
+			}
+		});
+}
+
+void dae::Renderer::RenderTriangle(const TriangleSetup& setup, uint32_t triangleIdx, int minX, int minY, int maxX, int maxY, RasterPass pass)
+{
+	TriangleEdges triangleEdges{};
+	if (!SetupTriangleEdges(setup.screenPositions[0], setup.screenPositions[1], setup.screenPositions[2], minX, minY, maxX, maxY, triangleEdges))
+		return;
+
+	//The interpolated depth is a weighted (harmonic) mean of the vertex depths, so it never gets below the nearest one
+	const float minDepth{ setup.minDepth };
+
+	const int firstBlockX{ triangleEdges.minX / HIZ_BLOCK_SIZE };
+	const int firstBlockY{ triangleEdges.minY / HIZ_BLOCK_SIZE };
+	const int lastBlockX{ (triangleEdges.maxX - 1) / HIZ_BLOCK_SIZE };
+	const int lastBlockY{ (triangleEdges.maxY - 1) / HIZ_BLOCK_SIZE };
+
+	if (IsOccluded(firstBlockX, firstBlockY, lastBlockX, lastBlockY, minDepth))
+		return;
+
+	PixelSpan pixelSpan{};
+
+	//RENDER LOGIC
+	for (int blockY{ firstBlockY }; blockY <= lastBlockY; ++blockY)
+	{
+		const int blockMinY{ std::max(blockY * HIZ_BLOCK_SIZE, triangleEdges.minY) };
+		const int blockMaxY{ std::min((blockY + 1) * HIZ_BLOCK_SIZE, triangleEdges.maxY) };
+
+		for (int blockX{ firstBlockX }; blockX <= lastBlockX; ++blockX)
+		{
+			//Every fragment of this triangle would fail the depth test in this block
+			float& blockMaxDepth{ m_pHiZBuffer[blockX + blockY * m_NrHiZBlocksX] };
+			if (minDepth > blockMaxDepth)
+				continue;
+
+			const int blockMinX{ std::max(blockX * HIZ_BLOCK_SIZE, triangleEdges.minX) };
+			const int blockMaxX{ std::min((blockX + 1) * HIZ_BLOCK_SIZE, triangleEdges.maxX) };
+
+			//Edge values at the first pixel of the block, skip the block when it lies completely outside one edge
+			//Spans that would overflow the 32 bit lanes fall back to the scalar reference kernel
+			SpanEdges spanEdges{};
+			bool isOutside{ false };
+			for (int i{}; i < 3; ++i)
+			{
+				const EdgeFunction& edge{ triangleEdges.edges[i] };
+				spanEdges.value[i] = edge.value + (blockMinX - triangleEdges.minX) * edge.stepX + (blockMinY - triangleEdges.minY) * edge.stepY;
+				spanEdges.stepX[i] = edge.stepX;
+				spanEdges.bias[i] = edge.bias;
+
+				const int64_t blockMaxValue{ spanEdges.value[i] + std::max<int64_t>(edge.stepX * (blockMaxX - blockMinX - 1), 0) + std::max<int64_t>(edge.stepY * (blockMaxY - blockMinY - 1), 0) };
+				isOutside |= blockMaxValue - edge.bias < 0;
+			}
+			if (isOutside)
+				continue;
+
+			//The equal pass recomputes exactly the same depth as the depth only pass, every kernel rounds the same way
+			RasterizeSpanFunction rasterizeSpan{};
+			if (pass == RasterPass::ShadeEqualDepth)
+				rasterizeSpan = FitsSimdRange(spanEdges) ? m_pRasterizeSpanEqual : RasterizeSpanScalar<DepthTest::Equal>;
+			else
+				rasterizeSpan = FitsSimdRange(spanEdges) ? m_pRasterizeSpan : RasterizeSpanScalar<DepthTest::Less>;
+			bool isDepthWritten{ false };
+
+			for (int py{ blockMinY }; py < blockMaxY; ++py)
+			{
+				const int spanPixelIdx{ GetPixelIndex(blockMinX, py) };
+				uint32_t passMask{ rasterizeSpan(spanEdges, setup.invDepth, triangleEdges.invArea, blockMaxX - blockMinX, m_pDepthBufferPixels + spanPixelIdx, pixelSpan) };
+
+				for (int i{}; i < 3; ++i)
+				{
+					spanEdges.value[i] += triangleEdges.edges[i].stepY;
+				}
+
+				isDepthWritten |= passMask != 0 && pass != RasterPass::ShadeEqualDepth;
+
+				//Visibility buffer: only remember who won, shading happens in ResolveVisibilityBuffer
+				if (pass == RasterPass::WriteVisibility)
+				{
+					while (passMask != 0)
+					{
+						const int lane{ std::countr_zero(passMask) };
+						passMask &= passMask - 1;
+
+						m_pVisibilityBuffer[spanPixelIdx + lane] = triangleIdx;
+					}
+				}
+
+				//Depth only: the shading happens in the ShadeEqualDepth pass
+				if (pass == RasterPass::DepthOnly || passMask == 0)
+					continue;
+
+				if (pass == RasterPass::WriteGBuffer)
+				{
+					if (m_pWriteGBufferSpan)
+						(this->*m_pWriteGBufferSpan)(setup, blockMinX, py, passMask, pixelSpan);
+					continue;
+				}
+
+				(this->*m_pShadeSpan)(setup, blockMinX, py, passMask, pixelSpan);
+			}
+
+			if (isDepthWritten)
+				blockMaxDepth = CalculateBlockMaxDepth(blockX, blockY);
+		}
+	}
+}
+
+void dae::Renderer::ResolveVisibilityBuffer()
+{
+	m_ThreadPool.ParallelFor(static_cast<uint32_t>(m_Height), [this](uint32_t row)
+		{
+			const int py{ static_cast<int>(row) };
+
+			for (int firstX{}; firstX < m_Width; firstX += SPAN_WIDTH)
+			{
+				const int firstPixelIdx{ GetPixelIndex(firstX, py) };
+				for (int lane{}; lane < std::min(SPAN_WIDTH, m_Width - firstX); ++lane)
+				{
+					const int pixelIdx{ firstPixelIdx + lane };
+					const uint32_t triangleIdx{ m_pVisibilityBuffer[pixelIdx] };
+					if (triangleIdx == INVALID_TRIANGLE)
+						continue;
+
+					//The attribute planes give the same result as in the forward path, no barycentrics needed
+					(this->*m_pShadePixel)(m_TriangleSetups[triangleIdx], firstX + lane, py, pixelIdx, m_pDepthBufferPixels[pixelIdx]);
+				}
+			}
+		});
+}
+
+bool dae::Renderer::IsOccluded(int firstBlockX, int firstBlockY, int lastBlockX, int lastBlockY, float minDepth) const
+{
+	for (int blockY{ firstBlockY }; blockY <= lastBlockY; ++blockY)
+	{
+		for (int blockX{ firstBlockX }; blockX <= lastBlockX; ++blockX)
+		{
+			if (minDepth <= m_pHiZBuffer[blockX + blockY * m_NrHiZBlocksX])
+				return false;
+		}
+	}
+	return true;
+}
+
+float dae::Renderer::CalculateBlockMaxDepth(int blockX, int blockY) const
+{
+	const int startX{ blockX * HIZ_BLOCK_SIZE };
+	const int startY{ blockY * HIZ_BLOCK_SIZE };
+	const int endX{ std::min(startX + HIZ_BLOCK_SIZE, m_Width) };
+	const int endY{ std::min(startY + HIZ_BLOCK_SIZE, m_Height) };
+
+	//Block rows are contiguous in both layouts
+	float maxDepth{ -FLT_MAX };
+	for (int py{ startY }; py < endY; ++py)
+	{
+		const float* pDepthRow{ m_pDepthBufferPixels + GetPixelIndex(startX, py) };
+		for (int i{}; i < endX - startX; ++i)
+		{
+			maxDepth = std::max(maxDepth, pDepthRow[i]);
+		}
+	}
+	return maxDepth;
+}
+
+int dae::Renderer::GetPixelIndex(int px, int py) const
+{
+	if (m_CurrentBufferLayout == BufferLayout::Linear)
+		return px + py * m_Width;
+
+	//Block index * block area + offset inside the block, every block row is LAYOUT_BLOCK_SIZE consecutive pixels
+	return ((px >> LAYOUT_BLOCK_SHIFT) + (py >> LAYOUT_BLOCK_SHIFT) * (m_PaddedWidth >> LAYOUT_BLOCK_SHIFT)) * LAYOUT_BLOCK_AREA
+		+ ((py & LAYOUT_BLOCK_MASK) << LAYOUT_BLOCK_SHIFT) + (px & LAYOUT_BLOCK_MASK);
+}
+
+void dae::Renderer::PresentBlockColorBuffer()
+{
+	//Swizzle back to the linear layout SDL expects, one row of blocks per job
+	const int nrBlocksX{ m_PaddedWidth / LAYOUT_BLOCK_SIZE };
+	const int nrBlockRows{ m_PaddedHeight / LAYOUT_BLOCK_SIZE };
+
+	m_ThreadPool.ParallelFor(static_cast<uint32_t>(nrBlockRows), [this, nrBlocksX](uint32_t blockRow)
+		{
+			const int startY{ static_cast<int>(blockRow) * LAYOUT_BLOCK_SIZE };
+			const int endY{ std::min(startY + LAYOUT_BLOCK_SIZE, m_Height) };
+
+			for (int blockX{}; blockX < nrBlocksX; ++blockX)
+			{
+				const int startX{ blockX * LAYOUT_BLOCK_SIZE };
+				const int count{ std::min(LAYOUT_BLOCK_SIZE, m_Width - startX) };
+
+				for (int py{ startY }; py < endY; ++py)
+				{
+					std::memcpy(m_pBackBufferPixels + startX + py * m_Width, m_pBlockColorBufferPixels + GetPixelIndex(startX, py), count * sizeof(uint32_t));
+				}
+			}
+		});
+}
+
+void dae::Renderer::SelectShadingFunctions()
+{
+	//[color mode][normal map], the depth buffer view doesn't look at either
+	static constexpr ShadingFunctions textureShadingFunctions[4][2]{
+		{ GetShadingFunctions<RenderMode::Texture, ColorMode::observedArea, false>(), GetShadingFunctions<RenderMode::Texture, ColorMode::observedArea, true>() },
+		{ GetShadingFunctions<RenderMode::Texture, ColorMode::Diffuse, false>(), GetShadingFunctions<RenderMode::Texture, ColorMode::Diffuse, true>() },
+		{ GetShadingFunctions<RenderMode::Texture, ColorMode::Specular, false>(), GetShadingFunctions<RenderMode::Texture, ColorMode::Specular, true>() },
+		{ GetShadingFunctions<RenderMode::Texture, ColorMode::Combined, false>(), GetShadingFunctions<RenderMode::Texture, ColorMode::Combined, true>() }
+	};
+	static constexpr ShadingFunctions depthShadingFunctions{ GetShadingFunctions<RenderMode::DepthBuffer, ColorMode::observedArea, false>() };
+
+	const ShadingFunctions& functions{ m_CurrentRendeMode == RenderMode::DepthBuffer ? depthShadingFunctions
+		: textureShadingFunctions[static_cast<int>(m_CurrentColorMode)][m_ShowNormals ? 1 : 0] };
+	m_pShadeSpan = functions.pShadeSpan;
+	m_pShadePixel = functions.pShadePixel;
+
+	//The visibility buffer resolve keeps shading pixel by pixel, its neighbours rarely share a triangle
+	m_pInterpolatePacket = nullptr;
+	m_pShadePacket = nullptr;
+
+	if (m_CurrentPipelineMode == PipelineMode::Deferred)
+	{
+		static constexpr ShadeSpanFunction writeGBufferFunctions[4][2]{
+			{ &Renderer::WriteGBufferSpan<ColorMode::observedArea, false>, &Renderer::WriteGBufferSpan<ColorMode::observedArea, true> },
+			{ &Renderer::WriteGBufferSpan<ColorMode::Diffuse, false>, &Renderer::WriteGBufferSpan<ColorMode::Diffuse, true> },
+			{ &Renderer::WriteGBufferSpan<ColorMode::Specular, false>, &Renderer::WriteGBufferSpan<ColorMode::Specular, true> },
+			{ &Renderer::WriteGBufferSpan<ColorMode::Combined, false>, &Renderer::WriteGBufferSpan<ColorMode::Combined, true> }
+		};
+		static constexpr ShadeGBufferRowFunction shadeGBufferRowFunctions[4]{
+			&Renderer::ShadeGBufferRow<RenderMode::Texture, ColorMode::observedArea>,
+			&Renderer::ShadeGBufferRow<RenderMode::Texture, ColorMode::Diffuse>,
+			&Renderer::ShadeGBufferRow<RenderMode::Texture, ColorMode::Specular>,
+			&Renderer::ShadeGBufferRow<RenderMode::Texture, ColorMode::Combined>
+		};
+
+		//The depth buffer view only needs the depth
+		if (m_CurrentRendeMode == RenderMode::DepthBuffer)
+		{
+			m_pWriteGBufferSpan = nullptr;
+			m_pShadeGBufferRow = &Renderer::ShadeGBufferRow<RenderMode::DepthBuffer, ColorMode::observedArea>;
+			return;
+		}
+
+		m_pWriteGBufferSpan = writeGBufferFunctions[static_cast<int>(m_CurrentColorMode)][m_ShowNormals ? 1 : 0];
+		m_pShadeGBufferRow = shadeGBufferRowFunctions[static_cast<int>(m_CurrentColorMode)];
+		//The G-buffer holds the final normal, the normal map already got applied
+		if (m_UsePacketShading)
+			m_pShadePacket = GetShadePacketFunction(m_SimdLevel, m_CurrentColorMode, false);
+		return;
+	}
+	if (!m_UsePacketShading || m_CurrentRendeMode != RenderMode::Texture)
+		return;
+
+	m_pInterpolatePacket = GetInterpolatePacketFunction(m_SimdLevel, m_CurrentColorMode, m_ShowNormals);
+	m_pShadePacket = GetShadePacketFunction(m_SimdLevel, m_CurrentColorMode, m_ShowNormals);
+	if (!m_pShadePacket)
+		return;
+
+	static constexpr ShadeSpanFunction packetShadeSpanFunctions[4][2]{
+		{ &Renderer::ShadeSpanPacket<ColorMode::observedArea, false>, &Renderer::ShadeSpanPacket<ColorMode::observedArea, true> },
+		{ &Renderer::ShadeSpanPacket<ColorMode::Diffuse, false>, &Renderer::ShadeSpanPacket<ColorMode::Diffuse, true> },
+		{ &Renderer::ShadeSpanPacket<ColorMode::Specular, false>, &Renderer::ShadeSpanPacket<ColorMode::Specular, true> },
+		{ &Renderer::ShadeSpanPacket<ColorMode::Combined, false>, &Renderer::ShadeSpanPacket<ColorMode::Combined, true> }
+	};
+	m_pShadeSpan = packetShadeSpanFunctions[static_cast<int>(m_CurrentColorMode)][m_ShowNormals ? 1 : 0];
+}
+
+template<ColorMode colorMode, bool useNormalMap>
+void dae::Renderer::ShadeSpanPacket(const TriangleSetup& setup, int firstX, int py, uint32_t passMask, const PixelSpan& pixelSpan)
+{
+	constexpr bool needsDiffuse{ colorMode == ColorMode::Diffuse || colorMode == ColorMode::Combined };
+	constexpr bool needsSpecular{ colorMode == ColorMode::Specular || colorMode == ColorMode::Combined };
+
+	//Sparse spans (small triangles, edges) are cheaper one pixel at a time
+	if (std::popcount(passMask) < PACKET_SHADING_MIN_LANES)
+	{
+		ShadeSpan<RenderMode::Texture, colorMode, useNormalMap>(setup, firstX, py, passMask, pixelSpan);
+		return;
+	}
+
+	ShadePacket packet;
+	m_pInterpolatePacket(setup, SnapToSubpixel(setup.screenPositions[0]), firstX, py, packet);
+
+	//Texture fetches stay scalar, only the lanes that passed get sampled
+	for (uint32_t mask{ passMask }; mask != 0; mask &= mask - 1)
+	{
+		const int lane{ std::countr_zero(mask) };
+		const Vector2 uv{ packet.uv[0][lane], packet.uv[1][lane] };
+
+		if constexpr (needsDiffuse)
+		{
+			const ColorRGB diffuse{ m_MeshTexture->Sample(uv) * setup.tint };
+			packet.diffuse[0][lane] = diffuse.r;
+			packet.diffuse[1][lane] = diffuse.g;
+			packet.diffuse[2][lane] = diffuse.b;
+		}
+		if constexpr (needsSpecular)
+		{
+			const ColorRGB specular{ m_pSpecularTexture->Sample(uv) };
+			packet.specular[0][lane] = specular.r;
+			packet.specular[1][lane] = specular.g;
+			packet.specular[2][lane] = specular.b;
+			packet.gloss[lane] = m_pGlossTexture->Sample(uv).r;
+		}
+		if constexpr (useNormalMap)
+		{
+			const ColorRGB sampledNormal{ m_pNormalTexture->Sample(uv) };
+			packet.sampledNormal[0][lane] = sampledNormal.r;
+			packet.sampledNormal[1][lane] = sampledNormal.g;
+			packet.sampledNormal[2][lane] = sampledNormal.b;
+		}
+	}
+
+	m_pShadePacket(m_ShadeConstants, GetTileLights(firstX, py), firstX, py, pixelSpan.depth, packet);
+
+	const int firstPixelIdx{ GetPixelIndex(firstX, py) };
+	for (; passMask != 0; passMask &= passMask - 1)
+	{
+		const int lane{ std::countr_zero(passMask) };
+		m_pColorBufferPixels[firstPixelIdx + lane] = SDL_MapRGB(m_pBackBuffer->format,
+			static_cast<uint8_t>(packet.color[0][lane] * 255),
+			static_cast<uint8_t>(packet.color[1][lane] * 255),
+			static_cast<uint8_t>(packet.color[2][lane] * 255));
+	}
+}
+
+template<RenderMode renderMode, ColorMode colorMode, bool useNormalMap>
+void dae::Renderer::ShadeSpan(const TriangleSetup& setup, int firstX, int py, uint32_t passMask, const PixelSpan& pixelSpan)
+{
+	const int firstPixelIdx{ GetPixelIndex(firstX, py) };
+	while (passMask != 0)
+	{
+		const int lane{ std::countr_zero(passMask) };
+		passMask &= passMask - 1;
+
+		ShadePixel<renderMode, colorMode, useNormalMap>(setup, firstX + lane, py, firstPixelIdx + lane, pixelSpan.depth[lane]);
+	}
+}
+
+template<RenderMode renderMode, ColorMode colorMode, bool useNormalMap>
+void dae::Renderer::ShadePixel(const TriangleSetup& setup, int px, int py, int pixelIdx, float interpolatedZDepth)
+{
+	if constexpr (renderMode == RenderMode::Texture)
+	{
+		constexpr bool needsViewDirection{ colorMode == ColorMode::Specular || colorMode == ColorMode::Combined };
+
+		const Vertex_Out interpolatedVertex{ InterpolateVertex<colorMode, useNormalMap, needsViewDirection>(setup, px, py) };
+
+		ColorRGB finalColor{ PixelShading<colorMode>(SampleSurface<colorMode, useNormalMap>(interpolatedVertex), interpolatedVertex.viewDirection, px, py, interpolatedZDepth) };
+
+		finalColor.MaxToOne();
+
+
+		//Update Color in Buffer
+		m_pColorBufferPixels[pixelIdx] = SDL_MapRGB(m_pBackBuffer->format,
+			static_cast<uint8_t>(finalColor.r * 255),
+			static_cast<uint8_t>(finalColor.g * 255),
+			static_cast<uint8_t>(finalColor.b * 255));
+	}
+	else
+	{
+		float depthColor = Utils::Remap(interpolatedZDepth, 0.985f, 1.f);
+
+
+		ColorRGB finalColor{ depthColor, depthColor, depthColor };
+
+
+		//Update Color in Buffer
+		m_pColorBufferPixels[pixelIdx] = SDL_MapRGB(m_pBackBuffer->format,
+			static_cast<uint8_t>(finalColor.r * 255),
+			static_cast<uint8_t>(finalColor.g * 255),
+			static_cast<uint8_t>(finalColor.b * 255));
+	}
+}
+
+template<ColorMode colorMode, bool useNormalMap>
+void dae::Renderer::WriteGBufferSpan(const TriangleSetup& setup, int firstX, int py, uint32_t passMask, const PixelSpan&)
+{
+	constexpr bool needsDiffuse{ colorMode == ColorMode::Diffuse || colorMode == ColorMode::Combined };
+	constexpr bool needsSpecular{ colorMode == ColorMode::Specular || colorMode == ColorMode::Combined };
+
+	const int firstPixelIdx{ GetPixelIndex(firstX, py) };
+	while (passMask != 0)
+	{
+		const int lane{ std::countr_zero(passMask) };
+		passMask &= passMask - 1;
+
+		const int px{ firstX + lane };
+		const Surface surface{ SampleSurface<colorMode, useNormalMap>(InterpolateVertex<colorMode, useNormalMap, false>(setup, px, py)) };
+
+		const int pixelIdx{ firstPixelIdx + lane };
+		m_pGBufferNormals[pixelIdx] = EncodeOctahedral(surface.normal);
+		if constexpr (needsDiffuse)
+			m_pGBufferAlbedo[pixelIdx] = PackUnorm8(surface.diffuse);
+		if constexpr (needsSpecular)
+			m_pGBufferSpecular[pixelIdx] = PackUnorm8(surface.specular, surface.gloss);
+	}
+}
+
+void dae::Renderer::ShadeGBuffer()
+{
+	m_ThreadPool.ParallelFor(static_cast<uint32_t>(m_Height), [this](uint32_t row)
+		{
+			(this->*m_pShadeGBufferRow)(static_cast<int>(row));
+		});
+}
+
+template<RenderMode renderMode, ColorMode colorMode>
+void dae::Renderer::ShadeGBufferRow(int py)
+{
+	constexpr bool needsDiffuse{ colorMode == ColorMode::Diffuse || colorMode == ColorMode::Combined };
+	constexpr bool needsSpecular{ colorMode == ColorMode::Specular || colorMode == ColorMode::Combined };
+
+	//One span at a time, its 8 pixels are consecutive in every plane and lie in one light tile
+	for (int firstX{}; firstX < m_Width; firstX += SPAN_WIDTH)
+	{
+		const int firstPixelIdx{ GetPixelIndex(firstX, py) };
+		const float* pDepths{ m_pDepthBufferPixels + firstPixelIdx };
+
+		//Pixels no triangle covers keep the clear color
+		uint32_t coverageMask{};
+		for (int lane{}; lane < std::min(SPAN_WIDTH, m_Width - firstX); ++lane)
+		{
+			if (pDepths[lane] != FLT_MAX)
+				coverageMask |= 1u << lane;
+		}
+		if (coverageMask == 0)
+			continue;
+
+		if constexpr (renderMode == RenderMode::DepthBuffer)
+		{
+			for (; coverageMask != 0; coverageMask &= coverageMask - 1)
+			{
+				const int lane{ std::countr_zero(coverageMask) };
+				const float depthColor{ Utils::Remap(pDepths[lane], 0.985f, 1.f) };
+				m_pColorBufferPixels[firstPixelIdx + lane] = SDL_MapRGB(m_pBackBuffer->format,
+					static_cast<uint8_t>(depthColor * 255),
+					static_cast<uint8_t>(depthColor * 255),
+					static_cast<uint8_t>(depthColor * 255));
+			}
+		}
+		else if (m_pShadePacket && std::popcount(coverageMask) >= PACKET_SHADING_MIN_LANES)
+		{
+			ShadePacket packet;
+			for (uint32_t mask{ coverageMask }; mask != 0; mask &= mask - 1)
+			{
+				const int lane{ std::countr_zero(mask) };
+				const Surface surface{ ReadGBuffer<colorMode>(firstPixelIdx + lane) };
+				for (int i{}; i < 3; ++i)
+				{
+					packet.normal[i][lane] = surface.normal[i];
+				}
+				if constexpr (needsDiffuse)
+				{
+					packet.diffuse[0][lane] = surface.diffuse.r;
+					packet.diffuse[1][lane] = surface.diffuse.g;
+					packet.diffuse[2][lane] = surface.diffuse.b;
+				}
+				if constexpr (needsSpecular)
+				{
+					packet.specular[0][lane] = surface.specular.r;
+					packet.specular[1][lane] = surface.specular.g;
+					packet.specular[2][lane] = surface.specular.b;
+					packet.gloss[lane] = surface.gloss;
+
+					const Vector3 viewDirection{ GetViewDirection(firstX + lane, py, pDepths[lane]) };
+					for (int i{}; i < 3; ++i)
+					{
+						packet.viewDirection[i][lane] = viewDirection[i];
+					}
+				}
+			}
+
+			m_pShadePacket(m_ShadeConstants, GetTileLights(firstX, py), firstX, py, pDepths, packet);
+
+			for (; coverageMask != 0; coverageMask &= coverageMask - 1)
+			{
+				const int lane{ std::countr_zero(coverageMask) };
+				m_pColorBufferPixels[firstPixelIdx + lane] = SDL_MapRGB(m_pBackBuffer->format,
+					static_cast<uint8_t>(packet.color[0][lane] * 255),
+					static_cast<uint8_t>(packet.color[1][lane] * 255),
+					static_cast<uint8_t>(packet.color[2][lane] * 255));
+			}
+		}
+		else
+		{
+			for (; coverageMask != 0; coverageMask &= coverageMask - 1)
+			{
+				const int lane{ std::countr_zero(coverageMask) };
+				const int px{ firstX + lane };
+
+				Vector3 viewDirection{};
+				if constexpr (needsSpecular)
+					viewDirection = GetViewDirection(px, py, pDepths[lane]);
+
+				ColorRGB finalColor{ PixelShading<colorMode>(ReadGBuffer<colorMode>(firstPixelIdx + lane), viewDirection, px, py, pDepths[lane]) };
+				finalColor.MaxToOne();
+
+				m_pColorBufferPixels[firstPixelIdx + lane] = SDL_MapRGB(m_pBackBuffer->format,
+					static_cast<uint8_t>(finalColor.r * 255),
+					static_cast<uint8_t>(finalColor.g * 255),
+					static_cast<uint8_t>(finalColor.b * 255));
+			}
+		}
+	}
+}
+
+template<ColorMode colorMode, bool useNormalMap, bool needsViewDirection>
+Vertex_Out dae::Renderer::InterpolateVertex(const TriangleSetup& setup, int px, int py) const
+{
+	constexpr bool needsUV{ useNormalMap || colorMode != ColorMode::observedArea };
+	constexpr bool needsColor{ colorMode == ColorMode::Diffuse || colorMode == ColorMode::Combined };
+
+	//Pixel centre relative to the first vertex of the (snapped) triangle
+	const Vector2 origin{ SnapToSubpixel(setup.screenPositions[0]) };
+	const float offsetX{ static_cast<float>(px) + 0.5f - origin.x };
+	const float offsetY{ static_cast<float>(py) + 0.5f - origin.y };
+
+	Vertex_Out interpolatedVertex{};
+
+	if constexpr (needsUV)
+	{
+		// Calculate the W depth at this pixel
+		const float interpolatedWDepth{ 1.0f / setup.invW.Evaluate(offsetX, offsetY) };
+		interpolatedVertex.uv = Vector2{ setup.uv[0].Evaluate(offsetX, offsetY), setup.uv[1].Evaluate(offsetX, offsetY) } * interpolatedWDepth;
+	}
+
+	//Normalizing gets rid of the w scale
+	interpolatedVertex.normal = Vector3{ setup.normal[0].Evaluate(offsetX, offsetY), setup.normal[1].Evaluate(offsetX, offsetY), setup.normal[2].Evaluate(offsetX, offsetY) }.Normalized();
+	if constexpr (useNormalMap)
+		interpolatedVertex.tangent = Vector3{ setup.tangent[0].Evaluate(offsetX, offsetY), setup.tangent[1].Evaluate(offsetX, offsetY), setup.tangent[2].Evaluate(offsetX, offsetY) }.Normalized();
+	if constexpr (needsViewDirection)
+		interpolatedVertex.viewDirection = Vector3{ setup.viewDirection[0].Evaluate(offsetX, offsetY), setup.viewDirection[1].Evaluate(offsetX, offsetY), setup.viewDirection[2].Evaluate(offsetX, offsetY) }.Normalized();
+	if constexpr (needsColor)
+		interpolatedVertex.color = setup.tint;
+
+	return interpolatedVertex;
+}
+
+template<ColorMode colorMode, bool useNormalMap>
+Renderer::Surface dae::Renderer::SampleSurface(const Vertex_Out& vertex_out) const
+{
+	constexpr bool needsDiffuse{ colorMode == ColorMode::Diffuse || colorMode == ColorMode::Combined };
+	constexpr bool needsSpecular{ colorMode == ColorMode::Specular || colorMode == ColorMode::Combined };
+
+	Surface surface{};
+	surface.normal = vertex_out.normal;
+	//Normal calculations
+	if constexpr (useNormalMap)
+	{
+		Vector3 binormal = Vector3::Cross(vertex_out.normal, vertex_out.tangent);
+		Matrix tangentSpaceAxis = Matrix{ vertex_out.tangent, binormal, vertex_out.normal, Vector3::Zero};
+		auto sampledNormal{ m_pNormalTexture->Sample(vertex_out.uv) };
+		
+		sampledNormal = (2.f * sampledNormal) - ColorRGB{1.f, 1.f, 1.f}; // [0, 1] -> [-1, 1]
+
+		Vector3 sampledNormalVector{sampledNormal.r, sampledNormal.g, sampledNormal.b};
+		surface.normal = tangentSpaceAxis.TransformVector(sampledNormalVector);
+	}
+
+	//vertex_out.color holds the instance tint
+	if constexpr (needsDiffuse)
+		surface.diffuse = m_MeshTexture->Sample(vertex_out.uv) * vertex_out.color;
+	if constexpr (needsSpecular)
+	{
+		surface.specular = m_pSpecularTexture->Sample(vertex_out.uv);
+		surface.gloss = m_pGlossTexture->Sample(vertex_out.uv).r;
+	}
+	return surface;
+}
+
+template<ColorMode colorMode>
+Renderer::Surface dae::Renderer::ReadGBuffer(int pixelIdx) const
+{
+	Surface surface{};
+	surface.normal = DecodeOctahedral(m_pGBufferNormals[pixelIdx]);
+	if constexpr (colorMode == ColorMode::Diffuse || colorMode == ColorMode::Combined)
+		surface.diffuse = UnpackUnorm8(m_pGBufferAlbedo[pixelIdx]);
+	if constexpr (colorMode == ColorMode::Specular || colorMode == ColorMode::Combined)
+	{
+		surface.specular = UnpackUnorm8(m_pGBufferSpecular[pixelIdx]);
+		surface.gloss = UnpackUnorm8W(m_pGBufferSpecular[pixelIdx]);
+	}
+	return surface;
+}
+
+Vector3 dae::Renderer::GetViewDirection(int px, int py, float depth) const
+{
+	//Normalized NDC position, like the vertices carry it
+	const float ndcX{ (static_cast<float>(px) + 0.5f) * 2.f / m_Width - 1.f };
+	const float ndcY{ 1.f - (static_cast<float>(py) + 0.5f) * 2.f / m_Height };
+	return Vector3{ ndcX, ndcY, depth }.Normalized();
+}
+
+template<ColorMode colorMode>
+ColorRGB dae::Renderer::PixelShading(const Surface& surface, const Vector3& viewDirection, int px, int py, float interpolatedZDepth)
+{
+	const Vector3& pixelNormal{ surface.normal };
+
+	ColorRGB finalColor{};
+	//Only point and spot lights need it
+	Vector3 worldPosition{};
+	bool hasWorldPosition{ false };
+	for (const uint32_t lightIdx : GetTileLights(px, py))
+	{
+		const Light& light{ m_ShadeConstants.pLights[lightIdx] };
+
+		Vector3 toLight{};
+		ColorRGB radiance{ light.color };
+		if (light.type == LightType::Directional)
+		{
+			toLight = -light.direction;
+		}
+		else
+		{
+			if (!hasWorldPosition)
+			{
+				worldPosition = GetWorldPosition(px, py, interpolatedZDepth);
+				hasWorldPosition = true;
+			}
+
+			const Vector3 offset{ light.position - worldPosition };
+			const float distanceSquared{ Vector3::Dot(offset, offset) };
+			if (!(distanceSquared < light.range * light.range))
+				continue;
+
+			toLight = offset / sqrtf(distanceSquared);
+			radiance *= GetLightAttenuation(light, toLight, distanceSquared);
+		}
+
+		float observedArea = std::max(Vector3::Dot(toLight, pixelNormal), 0.f);
+
+		ColorRGB contribution{};
+		if constexpr (colorMode == ColorMode::observedArea)
+		{
+			contribution = ColorRGB{ observedArea, observedArea, observedArea };
+		}
+		else if constexpr (colorMode == ColorMode::Diffuse)
+		{
+			contribution = Lambert(light.intensity, surface.diffuse) * observedArea;
+		}
+		else if constexpr (colorMode == ColorMode::Specular)
+		{
+			contribution = Phong(1.0f, surface.gloss, toLight, viewDirection, pixelNormal) * surface.specular;
+		}
+		else
+		{
+			auto phong{ surface.specular * Phong(1.0f, surface.gloss, toLight, viewDirection, pixelNormal) };
+			auto lambert{ Lambert(light.intensity, surface.diffuse) };
+
+			contribution = (light.intensity * lambert + phong) * observedArea;
+		}
+		finalColor += contribution * radiance;
+	}
+	return finalColor;
+}
+
+ColorRGB Renderer::Lambert(float kd, const ColorRGB& cd)
+{
+	return (kd * cd) / static_cast<float>(M_PI);
+}
+
+ColorRGB Renderer::Phong(float ks, float gloss, const Vector3& l, const Vector3& v, const Vector3& n)
+{
+
+	Vector3 reflect{ Vector3::Reflect(l,n) };
+	float angle = std::max(Vector3::Dot(reflect, v), 0.f);
+
+	const SpecularPowerTable* pSpecularTable{ m_ShadeConstants.pSpecularTable };
+	float specularReflection = ks * (pSpecularTable ? pSpecularTable->Lookup(angle, gloss) : powf(angle, gloss * m_ShadeConstants.glossiness));
+
+	return ColorRGB{ specularReflection, specularReflection, specularReflection };
+}
+
+bool Renderer::SaveBufferToImage() const
+{
+	return SDL_SaveBMP(m_pBackBuffer, "Rasterizer_ColorBuffer.bmp");
+}
+
+void dae::Renderer::SwitchRenderMode()
+{
+	m_CurrentRendeMode = static_cast<RenderMode>((static_cast<int>(m_CurrentRendeMode) + 1)  % (static_cast<int>(RenderMode::DepthBuffer) + 1));
 
 
 }
@@ -535,3 +1887,76 @@ void dae::Renderer::SwitchColorMode()
 {
 	m_CurrentColorMode = static_cast<ColorMode>((static_cast<int>(m_CurrentColorMode) + 1) % (static_cast<int>(ColorMode::Combined) + 1));
 }
+
+void dae::Renderer::ToggleNormalMap()
+{
+	m_ShowNormals = !m_ShowNormals;
+}
+
+void dae::Renderer::TogglePacketShading()
+{
+	m_UsePacketShading = !m_UsePacketShading;
+}
+
+void dae::Renderer::ToggleSpecularTable()
+{
+	m_UseSpecularTable = !m_UseSpecularTable;
+}
+
+void dae::Renderer::ToggleTiledRendering()
+{
+	m_UseTiledRendering = !m_UseTiledRendering;
+}
+
+void dae::Renderer::ToggleLodSelection()
+{
+	m_UseLodSelection = !m_UseLodSelection;
+}
+
+void dae::Renderer::ToggleOcclusionCulling()
+{
+	m_UseOcclusionCulling = !m_UseOcclusionCulling;
+}
+
+void dae::Renderer::ToggleDepthSorting()
+{
+	m_UseDepthSorting = !m_UseDepthSorting;
+}
+
+void dae::Renderer::ToggleMeshletCulling()
+{
+	m_UseMeshletCulling = !m_UseMeshletCulling;
+}
+
+void dae::Renderer::ToggleLazyVertexTransform()
+{
+	m_UseLazyVertexTransform = !m_UseLazyVertexTransform;
+}
+
+void dae::Renderer::SwitchPipelineMode()
+{
+	m_CurrentPipelineMode = static_cast<PipelineMode>((static_cast<int>(m_CurrentPipelineMode) + 1) % (static_cast<int>(PipelineMode::Deferred) + 1));
+}
+
+void dae::Renderer::SwitchBufferLayout()
+{
+	m_CurrentBufferLayout = static_cast<BufferLayout>((static_cast<int>(m_CurrentBufferLayout) + 1) % (static_cast<int>(BufferLayout::BlockLinear) + 1));
+	m_pColorBufferPixels = m_CurrentBufferLayout == BufferLayout::Linear ? m_pBackBufferPixels : m_pBlockColorBufferPixels;
+}
+
+void dae::Renderer::SwitchVertexLayout()
+{
+	m_CurrentVertexLayout = static_cast<VertexLayout>((static_cast<int>(m_CurrentVertexLayout) + 1) % (static_cast<int>(VertexLayout::StructOfArrays) + 1));
+}
+
+void dae::Renderer::SwitchCullMode()
+{
+	m_CurrentCullMode = static_cast<CullMode>((static_cast<int>(m_CurrentCullMode) + 1) % (static_cast<int>(CullMode::Front) + 1));
+}
+
+void dae::Renderer::SwitchSimdLevel()
+{
+	m_SimdLevel = static_cast<SimdLevel>((static_cast<int>(m_SimdLevel) + 1) % (static_cast<int>(m_MaxSimdLevel) + 1));
+	m_pRasterizeSpan = GetRasterizeSpanFunction(m_SimdLevel, DepthTest::Less);
+	m_pRasterizeSpanEqual = GetRasterizeSpanFunction(m_SimdLevel, DepthTest::Equal);
+}
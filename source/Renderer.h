@@ -1,10 +1,16 @@
 #pragma once
 
 #include <cstdint>
+#include <span>
 #include <vector>
 
 #include "Camera.h"
+#include "Culling.h"
 #include "DataTypes.h"
+#include "RasterKernels.h"
+#include "Scene.h"
+#include "ShadeKernels.h"
+#include "ThreadPool.h"
 
 struct SDL_Window;
 struct SDL_Surface;
@@ -15,7 +21,6 @@ namespace dae
 	struct Mesh;
 	struct Vertex;
 	class Timer;
-	class Scene;
 
 	enum class RenderMode
 	{
@@ -23,12 +28,43 @@ namespace dae
 		DepthBuffer
 	};
 
-	enum class ColorMode
+	enum class PipelineMode
 	{
-		observedArea,
-		Diffuse,
-		Specular,
-		Combined
+		Forward,
+		VisibilityBuffer,
+		DepthPrepass,
+		Deferred //the raster pass only fills the G-buffer, ShadeGBuffer lights every covered pixel once
+	};
+
+	//What RenderTriangle does with the fragments that pass
+	enum class RasterPass
+	{
+		Shade,
+		WriteVisibility,
+		DepthOnly,
+		ShadeEqualDepth, //depth pre-pass: only shades the fragments that won the depth only pass
+		WriteGBuffer
+	};
+
+	//Vertex storage the transform stage reads from
+	enum class VertexLayout
+	{
+		ArrayOfStructs, //Mesh::vertices, one vertex at a time
+		StructOfArrays //Mesh::vertexStreams, SIMD
+	};
+
+	//Memory layout of the internal color, depth and visibility buffers
+	enum class BufferLayout
+	{
+		Linear,
+		BlockLinear //8x8 blocks of 64 consecutive pixels, blocks in row-major order
+	};
+
+	enum class CullMode
+	{
+		None,
+		Back,
+		Front
 	};
 
 	class Renderer final
@@ -47,6 +83,20 @@ namespace dae
 		bool SaveBufferToImage() const;
 		void SwitchRenderMode();
 		void SwitchColorMode();
+		void ToggleNormalMap();
+		void TogglePacketShading();
+		void ToggleSpecularTable();
+		void ToggleTiledRendering();
+		void ToggleLazyVertexTransform();
+		void ToggleMeshletCulling();
+		void ToggleLodSelection();
+		void ToggleOcclusionCulling();
+		void ToggleDepthSorting();
+		void SwitchSimdLevel();
+		void SwitchPipelineMode();
+		void SwitchCullMode();
+		void SwitchBufferLayout();
+		void SwitchVertexLayout();
 
 	private:
 		SDL_Window* m_pWindow{};
@@ -59,26 +109,240 @@ namespace dae
 		Texture* m_pGlossTexture{ nullptr };
 		uint32_t* m_pBackBufferPixels{};
 
+		//Block-linear color buffer, gets swizzled into the back buffer when presenting
+		uint32_t* m_pBlockColorBufferPixels{};
+		//Back buffer (Linear) or the block-linear color buffer, depending on m_CurrentBufferLayout
+		uint32_t* m_pColorBufferPixels{};
+
 		float* m_pDepthBufferPixels{};
 
+		//Hierarchical Z: farthest stored depth of every 8x8 block of the depth buffer
+		float* m_pHiZBuffer{};
+		int m_NrHiZBlocksX{};
+		int m_NrHiZBlocksY{};
+
 		Camera m_Camera{};
 
 		int m_Width{};
 		int m_Height{};
+		//Buffer size rounded up to whole blocks, the internal buffers have this size
+		int m_PaddedWidth{};
+		int m_PaddedHeight{};
 		float m_AspectRatio{  };
-		Mesh m_MeshWorld;
+		Scene m_Scene{};
+		//Scene instances that survived frustum culling this frame
+		std::vector<uint32_t> m_VisibleInstances{};
 		RenderMode m_CurrentRendeMode;
 		ColorMode m_CurrentColorMode;
+		PipelineMode m_CurrentPipelineMode{ PipelineMode::Forward };
+		CullMode m_CurrentCullMode{ CullMode::Back };
+		BufferLayout m_CurrentBufferLayout{ BufferLayout::Linear };
+		VertexLayout m_CurrentVertexLayout{ VertexLayout::StructOfArrays };
+
+		//Visibility buffer: index (into m_TriangleSetups) of the visible triangle per pixel
+		uint32_t* m_pVisibilityBuffer{};
+
+		//G-buffer of the deferred pipeline, same layout as the color buffer, depth comes from the depth buffer
+		uint32_t* m_pGBufferNormals{}; //EncodeOctahedral
+		uint32_t* m_pGBufferAlbedo{}; //diffuse times the instance tint, PackUnorm8
+		uint32_t* m_pGBufferSpecular{}; //specular color with the gloss in w, PackUnorm8
 
 		bool m_CanRotate = true;
+		//Normal map
 		bool m_ShowNormals = false;
+
+		//Shading gets instantiated per render mode, color mode and normal map flag, SelectShadingFunctions picks the
+		//instantiation once per frame so none of the mode switches are left in the per pixel code
+		using ShadeSpanFunction = void (Renderer::*)(const TriangleSetup& setup, int firstX, int py, uint32_t passMask, const PixelSpan& pixelSpan);
+		using ShadePixelFunction = void (Renderer::*)(const TriangleSetup& setup, int px, int py, int pixelIdx, float interpolatedZDepth);
+		struct ShadingFunctions
+		{
+			ShadeSpanFunction pShadeSpan;
+			ShadePixelFunction pShadePixel;
+		};
+		ShadeSpanFunction m_pShadeSpan{};
+		ShadePixelFunction m_pShadePixel{};
+		//Deferred: the G-buffer gets written through a span function as well (nullptr when only depth is needed), then lit by rows
+		using ShadeGBufferRowFunction = void (Renderer::*)(int py);
+		ShadeSpanFunction m_pWriteGBufferSpan{};
+		ShadeGBufferRowFunction m_pShadeGBufferRow{};
+
+		//What the lights get evaluated against
+		struct Surface
+		{
+			Vector3 normal{};
+			ColorRGB diffuse{}; //already multiplied by the instance tint
+			ColorRGB specular{};
+			float gloss{};
+		};
+
+		//Texture mode spans get shaded 8 fragments at a time when AVX2 is selected, see ShadeKernels.h for the error bound
+		bool m_UsePacketShading = true;
+		InterpolatePacketFunction m_pInterpolatePacket{};
+		ShadePacketFunction m_pShadePacket{};
+
+		//Specular powers come from a gloss x cosine table (built in the constructor, rebuilt when the glossiness changes), off renders with the exact powf
+		bool m_UseSpecularTable = true;
+		SpecularPowerTable m_SpecularPowerTable{};
+
+		//Lights get culled per LIGHT_TILE_SIZE x LIGHT_TILE_SIZE screen tile, pixels only evaluate the lights of their tile
+		//The lights of tile i are m_TileLightIndices[m_TileLightOffsets[i], m_TileLightOffsets[i + 1][, in scene order
+		ShadeConstants m_ShadeConstants{};
+		int m_NrLightTilesX{};
+		int m_NrLightTilesY{};
+		std::vector<uint32_t> m_TileLightOffsets{};
+		std::vector<uint32_t> m_TileLightIndices{};
+		std::vector<uint32_t> m_TileLightCursors{};
+		//Inclusive tile rectangle of every light that reaches the screen this frame
+		struct LightTileRect
+		{
+			uint32_t lightIdx{};
+			int firstX{};
+			int firstY{};
+			int lastX{};
+			int lastY{};
+		};
+		std::vector<LightTileRect> m_LightTileRects{};
+
+		//Sort-middle: triangles get binned per screen tile, every tile is rasterized by one thread
+		bool m_UseTiledRendering = true;
+		ThreadPool m_ThreadPool{};
+		int m_NrTilesX{};
+		int m_NrTilesY{};
+		std::vector<std::vector<uint32_t>> m_TileBins{};
+
+		//Pixel kernel used for the spans of RenderTriangle, Scalar is the reference
+		SimdLevel m_MaxSimdLevel{ SimdLevel::Scalar };
+		SimdLevel m_SimdLevel{ SimdLevel::Scalar };
+		RasterizeSpanFunction m_pRasterizeSpan{ RasterizeSpanScalar<DepthTest::Less> };
+		RasterizeSpanFunction m_pRasterizeSpanEqual{ RasterizeSpanScalar<DepthTest::Equal> };
+
+		//Rejects whole meshlets (frustum and normal cone) before any of their triangles get assembled
+		bool m_UseMeshletCulling = true;
+
+		//Draws every instance with the coarsest level of detail whose error stays under LOD_MAX_PIXEL_ERROR on screen
+		bool m_UseLodSelection = true;
+
+		//Instances and meshlets get tested against the depth of the previous frame before anything of them is transformed
+		//What that hides gets a second test against the depth of this frame, so nothing that became visible goes missing
+		bool m_UseOcclusionCulling = true;
+		DepthPyramid m_DepthPyramid{};
+		struct OccludedMeshlet
+		{
+			uint32_t instanceIdx{};
+			uint32_t meshletIdx{};
+		};
+		std::vector<uint32_t> m_OccludedInstances{};
+		std::vector<OccludedMeshlet> m_OccludedMeshlets{};
+
+		//Triangles get rasterized nearest first, so the depth test rejects more of what lies behind them before it gets shaded
+		//Stable, so triangles at the same (quantized) depth keep their submission order
+		bool m_UseDepthSorting = true;
+		//Indices into m_TriangleSetups in the order they get rasterized
+		std::vector<uint32_t> m_DrawOrder{};
+		std::vector<uint16_t> m_DepthSortKeys{};
+		std::vector<uint32_t> m_SortScratch{};
+
+		//Lazy vertex transform: only vertices of assembled triangles get transformed, attributes only once a triangle survives culling
+		//A vertex is up to date when its tag equals m_VertexGeneration, bumping the generation invalidates all of them
+		bool m_UseLazyVertexTransform = false;
+		uint32_t m_VertexGeneration{};
+		std::vector<uint32_t> m_PositionGenerations{};
+		std::vector<uint32_t> m_AttributeGenerations{};
+
+		//Of the instance AssembleMesh is working on, its vertices are in mesh.vertices_out, m_ClipPositions and m_RasterVertices
+		uint32_t m_TransformedInstanceIdx{ UINT32_MAX }; //UINT32_MAX: none
+		bool m_IsTransformLazy{ false };
+		Matrix m_WorldMatrix{};
+		Matrix m_WorldViewProjectionMatrix{};
+		ColorRGB m_InstanceTint{};
+
+		//Per vertex of mesh.vertices_out: the position before the perspective divide (outcodes and clipping work on it) and on screen
+		std::vector<Vector4> m_ClipPositions{};
+		std::vector<Vector2> m_RasterVertices{};
+		std::vector<TriangleSetup> m_TriangleSetups{};
+
 		//Function that transforms the vertices from the mesh from World space to Screen space
-		void VertexTransformationFunction(); //W1 Version
+		void VertexTransformationFunction(Mesh& mesh); //W1 Version
 		void InitializeMesh();
-		bool IsInsideFrustrum(const Vector4& position);
-		void RenderTriangle(int idx0, int idx1, int idx2, std::vector<Vector2>& screenVertices);
-		ColorRGB PixelShading(const Vertex_Out& vertex_out);
+		void InitializeLights();
+		//Builds the per tile light lists of this frame and the shading constants
+		void CullLights(const Matrix& viewProjectionMatrix);
+		//Indices (into the scene lights) of the lights that can reach pixel (px, py)
+		std::span<const uint32_t> GetTileLights(int px, int py) const;
+		//Of the pixel centre at the depth buffer value depth
+		Vector3 GetWorldPosition(int px, int py, float depth) const;
+		//Transform, assembly, clipping and setup of one instance of mesh, appends to m_TriangleSetups
+		//Meshlets hidden by m_DepthPyramid go to pOccludedMeshlets, or get dropped when it is nullptr
+		void AssembleMesh(Mesh& mesh, const MeshInstance& instance, uint32_t instanceIdx, std::vector<OccludedMeshlet>* pOccludedMeshlets);
+		//Sets up the per instance state and transforms the vertices (or prepares the lazy transform)
+		//isLazy: transform vertices on demand even when m_UseLazyVertexTransform is off
+		void BeginInstance(Mesh& mesh, const MeshInstance& instance, uint32_t instanceIdx, bool isLazy);
+		void AssembleMeshlet(Mesh& mesh, const Meshlet& meshlet);
+		bool IsInstanceOccluded(const MeshInstance& instance) const;
+		//toClip: object to clip space of the view projection m_DepthPyramid was rendered with
+		bool IsMeshletOccluded(const Meshlet& meshlet, const Matrix& toClip) const;
+		uint32_t SelectLod(const Mesh& mesh, const MeshInstance& instance) const;
+		void BeginLazyVertexTransform(Mesh& mesh);
+		void TransformVertexPosition(Mesh& mesh, uint32_t vertexIdx);
+		void TransformVertexAttributes(Mesh& mesh, uint32_t vertexIdx);
+		//Index of pixel (px, py) in the color, depth and visibility buffers
+		//A span is consecutive in both layouts, so the per-pixel loops look up its first pixel once and add the lane
+		int GetPixelIndex(int px, int py) const;
+		void PresentBlockColorBuffer();
+		//frustum and cameraPosition are in object space
+		bool IsMeshletCulled(const Meshlet& meshlet, const Frustum& frustum, const Vector3& cameraPosition) const;
+		uint32_t CalculateOutCode(const Vector4& clipPosition) const;
+		void AssembleTriangle(Mesh& mesh, int idx0, int idx1, int idx2);
+		//Clips the clip space positions, the resulting vertices get appended to vertices_out (and m_ClipPositions, m_RasterVertices)
+		void ClipTriangle(Mesh& mesh, const Triangle& triangle, uint32_t clipPlanes);
+		//Face and micro-triangle culling on the screen space triangle, survivors get set up in m_TriangleSetups
+		void SubmitTriangle(Mesh& mesh, const Triangle& triangle);
+		void SetupTriangle(Mesh& mesh, const Triangle& triangle);
+		//Rasterizes m_TriangleSetups from firstTriangleIdx on, tiled or serial
+		void RasterizeTriangles(uint32_t firstTriangleIdx);
+		//Fills m_DrawOrder with the triangles from firstTriangleIdx on, sorted front to back when m_UseDepthSorting
+		void BuildDrawOrder(uint32_t firstTriangleIdx);
+		void RenderTiled();
+		//Only pixels inside [minX, maxX[ x [minY, maxY[ get touched, so tiles can run in parallel
+		void RenderTriangle(const TriangleSetup& setup, uint32_t triangleIdx, int minX, int minY, int maxX, int maxY, RasterPass pass);
+		void ResolveVisibilityBuffer();
+		//Lights every covered pixel of the G-buffer, rows in parallel
+		void ShadeGBuffer();
+		bool IsOccluded(int firstBlockX, int firstBlockY, int lastBlockX, int lastBlockY, float minDepth) const;
+		float CalculateBlockMaxDepth(int blockX, int blockY) const;
+		template<RenderMode renderMode, ColorMode colorMode, bool useNormalMap>
+		static constexpr ShadingFunctions GetShadingFunctions()
+		{
+			return ShadingFunctions{ &Renderer::ShadeSpan<renderMode, colorMode, useNormalMap>, &Renderer::ShadePixel<renderMode, colorMode, useNormalMap> };
+		}
+		void SelectShadingFunctions();
+		//Shades the pixels of passMask, lane i is pixel (firstX + i, py)
+		template<RenderMode renderMode, ColorMode colorMode, bool useNormalMap>
+		void ShadeSpan(const TriangleSetup& setup, int firstX, int py, uint32_t passMask, const PixelSpan& pixelSpan);
+		//Same as ShadeSpan in Texture mode, through the packet kernels
+		template<ColorMode colorMode, bool useNormalMap>
+		void ShadeSpanPacket(const TriangleSetup& setup, int firstX, int py, uint32_t passMask, const PixelSpan& pixelSpan);
+		template<RenderMode renderMode, ColorMode colorMode, bool useNormalMap>
+		//pixelIdx: GetPixelIndex(px, py)
+		void ShadePixel(const TriangleSetup& setup, int px, int py, int pixelIdx, float interpolatedZDepth);
+		//Writes the G-buffer planes colorMode reads for the pixels of passMask
+		template<ColorMode colorMode, bool useNormalMap>
+		void WriteGBufferSpan(const TriangleSetup& setup, int firstX, int py, uint32_t passMask, const PixelSpan& pixelSpan);
+		template<RenderMode renderMode, ColorMode colorMode>
+		void ShadeGBufferRow(int py);
+		//Only the attributes the color mode reads get interpolated
+		template<ColorMode colorMode, bool useNormalMap, bool needsViewDirection>
+		Vertex_Out InterpolateVertex(const TriangleSetup& setup, int px, int py) const;
+		template<ColorMode colorMode, bool useNormalMap>
+		Surface SampleSurface(const Vertex_Out& vertex_out) const;
+		template<ColorMode colorMode>
+		Surface ReadGBuffer(int pixelIdx) const;
+		//The deferred pipeline has no interpolated view direction, it takes the one the vertices get at the pixel itself
+		Vector3 GetViewDirection(int px, int py, float depth) const;
+		template<ColorMode colorMode>
+		ColorRGB PixelShading(const Surface& surface, const Vector3& viewDirection, int px, int py, float interpolatedZDepth);
 		ColorRGB Lambert(float kd, const ColorRGB& cd);
-		ColorRGB Phong(float ks, float exp, const Vector3& l, const Vector3& v, const Vector3& n);
+		ColorRGB Phong(float ks, float gloss, const Vector3& l, const Vector3& v, const Vector3& n);
 	};
 }
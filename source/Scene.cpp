@@ -0,0 +1,227 @@
+#include "Scene.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace dae;
+
+//Leaves hold at most this many instances
+constexpr uint32_t MAX_LEAF_INSTANCES{ 2 };
+//Deeper than a median split of 2^32 instances can get
+constexpr int MAX_BVH_DEPTH{ 64 };
+
+uint32_t Scene::AddMesh(Mesh&& mesh)
+{
+	BoundingBox& bounds{ m_MeshBounds.emplace_back() };
+	for (const Vertex& vertex : mesh.vertices)
+	{
+		bounds.Grow(vertex.position);
+	}
+
+	m_Meshes.push_back(std::move(mesh));
+	return static_cast<uint32_t>(m_Meshes.size() - 1);
+}
+
+uint32_t Scene::AddInstance(uint32_t meshIdx, const Matrix& worldMatrix, const ColorRGB& tint)
+{
+	SceneInstance& sceneInstance{ m_Instances.emplace_back() };
+	sceneInstance.instance = MeshInstance{ meshIdx, worldMatrix, tint };
+	UpdateWorldBounds(sceneInstance);
+
+	m_IsBVHValid = false;
+	return static_cast<uint32_t>(m_Instances.size() - 1);
+}
+
+uint32_t Scene::AddInstances(uint32_t meshIdx, std::span<const Matrix> worldMatrices, std::span<const ColorRGB> tints)
+{
+	assert((tints.empty() || tints.size() == worldMatrices.size()) && "Need one tint per world matrix, or none");
+
+	const uint32_t firstInstanceIdx{ static_cast<uint32_t>(m_Instances.size()) };
+	m_Instances.reserve(m_Instances.size() + worldMatrices.size());
+	for (size_t i{}; i < worldMatrices.size(); ++i)
+	{
+		AddInstance(meshIdx, worldMatrices[i], tints.empty() ? ColorRGB{ 1.f, 1.f, 1.f } : tints[i]);
+	}
+	return firstInstanceIdx;
+}
+
+void Scene::SetWorldMatrix(uint32_t instanceIdx, const Matrix& worldMatrix)
+{
+	SceneInstance& sceneInstance{ m_Instances[instanceIdx] };
+	sceneInstance.instance.worldMatrix = worldMatrix;
+	sceneInstance.isMoved = true;
+}
+
+uint32_t Scene::AddLight(const Light& light)
+{
+	m_Lights.push_back(light);
+	return static_cast<uint32_t>(m_Lights.size() - 1);
+}
+
+void Scene::UpdateBVH()
+{
+	if (m_IsBVHValid)
+	{
+		RefitBVH();
+		return;
+	}
+
+	for (SceneInstance& sceneInstance : m_Instances)
+	{
+		UpdateWorldBounds(sceneInstance);
+		sceneInstance.isMoved = false;
+	}
+	BuildBVH();
+	m_IsBVHValid = true;
+}
+
+void Scene::QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& instanceIndices) const
+{
+	instanceIndices.clear();
+	if (m_Nodes.empty())
+		return;
+
+	uint32_t stack[MAX_BVH_DEPTH + 1]{};
+	int stackSize{ 1 };
+
+	while (stackSize > 0)
+	{
+		const uint32_t nodeIdx{ stack[--stackSize] };
+		const BVHNode& node{ m_Nodes[nodeIdx] };
+		if (frustum.IsBoxOutside(node.bounds))
+			continue;
+
+		if (node.nrInstances == 0)
+		{
+			//Left child gets popped first
+			stack[stackSize++] = node.rightChildIdx;
+			stack[stackSize++] = nodeIdx + 1;
+			continue;
+		}
+
+		for (uint32_t i{ node.firstInstance }; i < node.firstInstance + node.nrInstances; ++i)
+		{
+			const uint32_t instanceIdx{ m_InstanceOrder[i] };
+			if (node.nrInstances == 1 || !frustum.IsBoxOutside(m_Instances[instanceIdx].worldBounds))
+				instanceIndices.push_back(instanceIdx);
+		}
+	}
+}
+
+void Scene::UpdateWorldBounds(SceneInstance& sceneInstance) const
+{
+	sceneInstance.worldBounds = m_MeshBounds[sceneInstance.instance.meshIdx].Transformed(sceneInstance.instance.worldMatrix);
+}
+
+void Scene::BuildBVH()
+{
+	m_Nodes.clear();
+	m_InstanceOrder.resize(m_Instances.size());
+	for (uint32_t i{}; i < static_cast<uint32_t>(m_Instances.size()); ++i)
+	{
+		m_InstanceOrder[i] = i;
+	}
+
+	if (m_Instances.empty())
+		return;
+
+	//Every leaf holds at least one instance, so a binary tree never needs more than 2n - 1 nodes
+	m_Nodes.reserve(2 * m_Instances.size() - 1);
+	BuildNode(0, 0, static_cast<uint32_t>(m_Instances.size()));
+}
+
+uint32_t Scene::BuildNode(uint32_t parentIdx, uint32_t firstInstance, uint32_t nrInstances)
+{
+	const uint32_t nodeIdx{ static_cast<uint32_t>(m_Nodes.size()) };
+	m_Nodes.push_back(BVHNode{});
+	m_Nodes[nodeIdx].parentIdx = parentIdx;
+
+	BoundingBox bounds{};
+	BoundingBox centerBounds{};
+	for (uint32_t i{ firstInstance }; i < firstInstance + nrInstances; ++i)
+	{
+		const BoundingBox& instanceBounds{ m_Instances[m_InstanceOrder[i]].worldBounds };
+		bounds.Grow(instanceBounds);
+		centerBounds.Grow(instanceBounds.GetCenter());
+	}
+	m_Nodes[nodeIdx].bounds = bounds;
+
+	if (nrInstances <= MAX_LEAF_INSTANCES)
+	{
+		m_Nodes[nodeIdx].firstInstance = firstInstance;
+		m_Nodes[nodeIdx].nrInstances = nrInstances;
+		for (uint32_t i{ firstInstance }; i < firstInstance + nrInstances; ++i)
+		{
+			m_Instances[m_InstanceOrder[i]].leafIdx = nodeIdx;
+		}
+		return nodeIdx;
+	}
+
+	//Median split along the longest axis of the instance centers, keeps the tree balanced
+	const Vector3 extent{ centerBounds.max - centerBounds.min };
+	int axis{ extent.x >= extent.y ? 0 : 1 };
+	if (extent.z > extent[axis])
+		axis = 2;
+
+	const auto first{ m_InstanceOrder.begin() + firstInstance };
+	const uint32_t nrLeftInstances{ nrInstances / 2 };
+	std::nth_element(first, first + nrLeftInstances, first + nrInstances, [&](uint32_t a, uint32_t b)
+		{
+			return m_Instances[a].worldBounds.GetCenter()[axis] < m_Instances[b].worldBounds.GetCenter()[axis];
+		});
+
+	//m_Nodes grows while building the children, no references into it past this point
+	BuildNode(nodeIdx, firstInstance, nrLeftInstances);
+	const uint32_t rightChildIdx{ BuildNode(nodeIdx, firstInstance + nrLeftInstances, nrInstances - nrLeftInstances) };
+	m_Nodes[nodeIdx].rightChildIdx = rightChildIdx;
+	return nodeIdx;
+}
+
+void Scene::RefitBVH()
+{
+	//Flag the leaves of moved instances and everything above them, stop at nodes that are flagged already
+	bool hasMoved{ false };
+	for (SceneInstance& sceneInstance : m_Instances)
+	{
+		if (!sceneInstance.isMoved)
+			continue;
+
+		UpdateWorldBounds(sceneInstance);
+		sceneInstance.isMoved = false;
+		hasMoved = true;
+
+		uint32_t nodeIdx{ sceneInstance.leafIdx };
+		while (!m_Nodes[nodeIdx].needsRefit)
+		{
+			m_Nodes[nodeIdx].needsRefit = true;
+			if (nodeIdx == 0)
+				break;
+			nodeIdx = m_Nodes[nodeIdx].parentIdx;
+		}
+	}
+
+	if (!hasMoved)
+		return;
+
+	//Children always come after their parent, so going backwards refits bottom-up
+	for (size_t nodeIdx{ m_Nodes.size() }; nodeIdx-- > 0;)
+	{
+		BVHNode& node{ m_Nodes[nodeIdx] };
+		if (!node.needsRefit)
+			continue;
+		node.needsRefit = false;
+
+		node.bounds = BoundingBox{};
+		if (node.nrInstances == 0)
+		{
+			node.bounds.Grow(m_Nodes[nodeIdx + 1].bounds);
+			node.bounds.Grow(m_Nodes[node.rightChildIdx].bounds);
+			continue;
+		}
+
+		for (uint32_t i{ node.firstInstance }; i < node.firstInstance + node.nrInstances; ++i)
+		{
+			node.bounds.Grow(m_Instances[m_InstanceOrder[i]].worldBounds);
+		}
+	}
+}
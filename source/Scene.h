@@ -0,0 +1,97 @@
+#pragma once
+
+//Standard includes
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "ColorRGB.h"
+#include "Culling.h"
+#include "DataTypes.h"
+#include "Light.h"
+
+namespace dae
+{
+	//One draw of a mesh, the vertex data stays shared between all instances of it
+	struct MeshInstance
+	{
+		uint32_t meshIdx{};
+		Matrix worldMatrix{};
+		//Multiplies the diffuse color
+		ColorRGB tint{ 1.f, 1.f, 1.f };
+	};
+
+	//Owns every mesh that gets drawn, their instances and the lights, with a bounding volume hierarchy over the world space bounds of the instances
+	class Scene final
+	{
+	public:
+		Scene() = default;
+		~Scene() = default;
+
+		Scene(const Scene&) = delete;
+		Scene(Scene&&) noexcept = delete;
+		Scene& operator=(const Scene&) = delete;
+		Scene& operator=(Scene&&) noexcept = delete;
+
+		//Returns the index of the new mesh, it doesn't get drawn before it has instances
+		uint32_t AddMesh(Mesh&& mesh);
+		Mesh& GetMesh(uint32_t meshIdx) { return m_Meshes[meshIdx]; }
+		//Object space bounding box of the mesh
+		const BoundingBox& GetMeshBounds(uint32_t meshIdx) const { return m_MeshBounds[meshIdx]; }
+
+		//Return the index of the (first) new instance, the BVH gets rebuilt on the next UpdateBVH
+		uint32_t AddInstance(uint32_t meshIdx, const Matrix& worldMatrix, const ColorRGB& tint = ColorRGB{ 1.f, 1.f, 1.f });
+		//tints is either empty (no tint) or has one color per world matrix
+		uint32_t AddInstances(uint32_t meshIdx, std::span<const Matrix> worldMatrices, std::span<const ColorRGB> tints = {});
+		const MeshInstance& GetInstance(uint32_t instanceIdx) const { return m_Instances[instanceIdx].instance; }
+		uint32_t GetNrInstances() const { return static_cast<uint32_t>(m_Instances.size()); }
+
+		//Marks the instance as moved, its BVH leaf gets refit on the next UpdateBVH
+		void SetWorldMatrix(uint32_t instanceIdx, const Matrix& worldMatrix);
+
+		//Returns the index of the new light
+		uint32_t AddLight(const Light& light);
+		std::span<const Light> GetLights() const { return m_Lights; }
+
+		//Full rebuild after instances were added, otherwise only the nodes above moved instances get refit
+		void UpdateBVH();
+		//Instances whose world space bounds aren't outside the (world space) frustum
+		void QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& instanceIndices) const;
+
+	private:
+		struct SceneInstance
+		{
+			MeshInstance instance{};
+			BoundingBox worldBounds{};
+			uint32_t leafIdx{};
+			bool isMoved{ false };
+		};
+
+		//Leaves have nrInstances > 0 and own m_InstanceOrder[firstInstance, firstInstance + nrInstances[
+		//Inner nodes have two children, the left one directly follows its parent
+		struct BVHNode
+		{
+			BoundingBox bounds{};
+			uint32_t parentIdx{};
+			uint32_t rightChildIdx{};
+			uint32_t firstInstance{};
+			uint32_t nrInstances{};
+			bool needsRefit{ false };
+		};
+
+		std::vector<Mesh> m_Meshes{};
+		//Object space bounds, per mesh
+		std::vector<BoundingBox> m_MeshBounds{};
+		std::vector<SceneInstance> m_Instances{};
+		std::vector<Light> m_Lights{};
+
+		std::vector<BVHNode> m_Nodes{};
+		std::vector<uint32_t> m_InstanceOrder{};
+		bool m_IsBVHValid{ false };
+
+		void UpdateWorldBounds(SceneInstance& sceneInstance) const;
+		void BuildBVH();
+		uint32_t BuildNode(uint32_t parentIdx, uint32_t firstInstance, uint32_t nrInstances);
+		void RefitBVH();
+	};
+}
@@ -0,0 +1,443 @@
+#include "ShadeKernels.h"
+
+#include <cmath>
+#include <immintrin.h>
+
+//MSVC allows any intrinsic everywhere, GCC and Clang need to be told per function
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+//Note: no FMA here either, every operation rounds like its counterpart in Renderer::ShadePixel and Renderer::PixelShading
+
+namespace dae
+{
+	static_assert(SPAN_WIDTH == 8, "One packet is one AVX2 register per attribute component");
+
+	TARGET_AVX2 static __m256 EvaluatePlane(const AttributePlane& plane, __m256 offsetX, __m256 offsetY)
+	{
+		return _mm256_add_ps(_mm256_add_ps(_mm256_set1_ps(plane.value), _mm256_mul_ps(_mm256_set1_ps(plane.dx), offsetX)), _mm256_mul_ps(_mm256_set1_ps(plane.dy), offsetY));
+	}
+
+	//Same as Vector3::Normalized
+	TARGET_AVX2 static void InterpolateDirection(const AttributePlane planes[3], __m256 offsetX, __m256 offsetY, float direction[3][SPAN_WIDTH])
+	{
+		const __m256 x{ EvaluatePlane(planes[0], offsetX, offsetY) };
+		const __m256 y{ EvaluatePlane(planes[1], offsetX, offsetY) };
+		const __m256 z{ EvaluatePlane(planes[2], offsetX, offsetY) };
+		const __m256 magnitude{ _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z))) };
+		_mm256_store_ps(direction[0], _mm256_div_ps(x, magnitude));
+		_mm256_store_ps(direction[1], _mm256_div_ps(y, magnitude));
+		_mm256_store_ps(direction[2], _mm256_div_ps(z, magnitude));
+	}
+
+	template<ColorMode colorMode, bool useNormalMap>
+	TARGET_AVX2 static void InterpolatePacketAVX2(const TriangleSetup& setup, const Vector2& origin, int firstX, int py, ShadePacket& packet)
+	{
+		constexpr bool needsUV{ useNormalMap || colorMode != ColorMode::observedArea };
+		constexpr bool needsViewDirection{ colorMode == ColorMode::Specular || colorMode == ColorMode::Combined };
+
+		const __m256 px{ _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(firstX), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))) };
+		const __m256 offsetX{ _mm256_sub_ps(_mm256_add_ps(px, _mm256_set1_ps(0.5f)), _mm256_set1_ps(origin.x)) };
+		const __m256 offsetY{ _mm256_set1_ps(static_cast<float>(py) + 0.5f - origin.y) };
+
+		if constexpr (needsUV)
+		{
+			const __m256 wDepth{ _mm256_div_ps(_mm256_set1_ps(1.f), EvaluatePlane(setup.invW, offsetX, offsetY)) };
+			_mm256_store_ps(packet.uv[0], _mm256_mul_ps(EvaluatePlane(setup.uv[0], offsetX, offsetY), wDepth));
+			_mm256_store_ps(packet.uv[1], _mm256_mul_ps(EvaluatePlane(setup.uv[1], offsetX, offsetY), wDepth));
+		}
+
+		InterpolateDirection(setup.normal, offsetX, offsetY, packet.normal);
+		if constexpr (useNormalMap)
+			InterpolateDirection(setup.tangent, offsetX, offsetY, packet.tangent);
+		if constexpr (needsViewDirection)
+			InterpolateDirection(setup.viewDirection, offsetX, offsetY, packet.viewDirection);
+	}
+
+	//log2 of positive normal floats: exponent + 2 / ln(2) * atanh(t), t = (m - 1) / (m + 1) with the mantissa m in
+	//[sqrt(0.5), sqrt(2)[, so |t| <= 0.1716 and the first omitted term of the series is below 5e-8
+	TARGET_AVX2 static __m256 Log2(__m256 x)
+	{
+		const __m256i bits{ _mm256_castps_si256(x) };
+		__m256i exponent{ _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)) };
+		__m256 mantissa{ _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000))) };
+
+		const __m256 isLarge{ _mm256_cmp_ps(mantissa, _mm256_set1_ps(1.41421356f), _CMP_GT_OQ) };
+		mantissa = _mm256_blendv_ps(mantissa, _mm256_mul_ps(mantissa, _mm256_set1_ps(0.5f)), isLarge);
+		exponent = _mm256_sub_epi32(exponent, _mm256_castps_si256(isLarge)); //true lanes are -1
+
+		const __m256 t{ _mm256_div_ps(_mm256_sub_ps(mantissa, _mm256_set1_ps(1.f)), _mm256_add_ps(mantissa, _mm256_set1_ps(1.f))) };
+		const __m256 t2{ _mm256_mul_ps(t, t) };
+		__m256 series{ _mm256_set1_ps(0.41219858f) };
+		series = _mm256_add_ps(_mm256_mul_ps(series, t2), _mm256_set1_ps(0.57707802f));
+		series = _mm256_add_ps(_mm256_mul_ps(series, t2), _mm256_set1_ps(0.96179669f));
+		series = _mm256_add_ps(_mm256_mul_ps(series, t2), _mm256_set1_ps(2.88539008f));
+
+		return _mm256_add_ps(_mm256_cvtepi32_ps(exponent), _mm256_mul_ps(series, t));
+	}
+
+	//2^round(x) * 2^f, f in [-0.5, 0.5] through its Taylor series up to f^6 (relative error below 2e-7)
+	//Below 2^-126 the result stays at about 2^-126, too small to matter. Above 2^128 it overflows to infinity like powf
+	TARGET_AVX2 static __m256 Exp2(__m256 x)
+	{
+		x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-126.f)), _mm256_set1_ps(128.5f));
+		const __m256 rounded{ _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC) };
+		const __m256 f{ _mm256_sub_ps(x, rounded) };
+
+		__m256 series{ _mm256_set1_ps(1.5403530e-4f) };
+		series = _mm256_add_ps(_mm256_mul_ps(series, f), _mm256_set1_ps(1.3333558e-3f));
+		series = _mm256_add_ps(_mm256_mul_ps(series, f), _mm256_set1_ps(9.6181291e-3f));
+		series = _mm256_add_ps(_mm256_mul_ps(series, f), _mm256_set1_ps(5.5504109e-2f));
+		series = _mm256_add_ps(_mm256_mul_ps(series, f), _mm256_set1_ps(0.24022651f));
+		series = _mm256_add_ps(_mm256_mul_ps(series, f), _mm256_set1_ps(0.69314718f));
+		series = _mm256_add_ps(_mm256_mul_ps(series, f), _mm256_set1_ps(1.f));
+
+		//2^(round(x) - 1) * 2, so a rounded 128 doesn't end up in the exponent bits as infinity
+		const __m256i scale{ _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(rounded), _mm256_set1_epi32(126)), 23) };
+		return _mm256_mul_ps(_mm256_mul_ps(series, _mm256_castsi256_ps(scale)), _mm256_set1_ps(2.f));
+	}
+
+	//powf for x >= 0, including powf(0, 0) = 1 and powf(0, y > 0) = 0
+	TARGET_AVX2 static __m256 Pow(__m256 x, __m256 y)
+	{
+		const __m256 zero{ _mm256_setzero_ps() };
+		const __m256 result{ Exp2(_mm256_mul_ps(y, Log2(x))) };
+		const __m256 zeroBase{ _mm256_blendv_ps(zero, _mm256_set1_ps(1.f), _mm256_cmp_ps(y, zero, _CMP_EQ_OQ)) };
+		return _mm256_blendv_ps(result, zeroBase, _mm256_cmp_ps(x, zero, _CMP_LE_OQ));
+	}
+
+	//SpecularPowerTable::Lookup, lanes it doesn't cover go through Pow
+	TARGET_AVX2 static __m256 LookupSpecularPower(const SpecularPowerTable& table, __m256 cosine, __m256 gloss, __m256 exponent)
+	{
+		const __m256i row{ _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(gloss, _mm256_set1_ps(255.f)), _mm256_set1_ps(0.5f))) };
+		const __m256 position{ _mm256_mul_ps(cosine, _mm256_set1_ps(static_cast<float>(SpecularPowerTable::NR_COSINE_STEPS))) };
+		const __m256i step{ _mm256_cvttps_epi32(position) };
+		const __m256 t{ _mm256_sub_ps(position, _mm256_cvtepi32_ps(step)) };
+
+		const __m256i isBelowTable{ _mm256_cmpgt_epi32(_mm256_set1_epi32(table.firstRow), row) };
+		const __m256i isAboveTable{ _mm256_cmpgt_epi32(row, _mm256_set1_epi32(SpecularPowerTable::NR_GLOSS_ROWS - 1)) };
+		//!(cosine < 1), NaN included
+		const __m256 isNotBelowOne{ _mm256_cmp_ps(cosine, _mm256_set1_ps(1.f), _CMP_NLT_UQ) };
+		const __m256 isFallback{ _mm256_or_ps(_mm256_castsi256_ps(_mm256_or_si256(isBelowTable, isAboveTable)), isNotBelowOne) };
+
+		//Fallback lanes (and the garbage in lanes nobody reads) still need an index inside the table
+		const __m256i clampedRow{ _mm256_min_epi32(_mm256_max_epi32(row, _mm256_setzero_si256()), _mm256_set1_epi32(SpecularPowerTable::NR_GLOSS_ROWS - 1)) };
+		const __m256i clampedStep{ _mm256_min_epi32(_mm256_max_epi32(step, _mm256_setzero_si256()), _mm256_set1_epi32(SpecularPowerTable::NR_COSINE_STEPS - 1)) };
+		const __m256i index{ _mm256_add_epi32(_mm256_mullo_epi32(clampedRow, _mm256_set1_epi32(SpecularPowerTable::NR_COSINE_STEPS + 1)), clampedStep) };
+		const __m256 value0{ _mm256_i32gather_ps(table.values.data(), index, 4) };
+		const __m256 value1{ _mm256_i32gather_ps(table.values.data() + 1, index, 4) };
+		const __m256 result{ _mm256_add_ps(value0, _mm256_mul_ps(_mm256_sub_ps(value1, value0), t)) };
+
+		if (_mm256_movemask_ps(isFallback) == 0)
+			return result;
+		return _mm256_blendv_ps(result, Pow(cosine, exponent), isFallback);
+	}
+
+	TARGET_AVX2 static __m256 Dot(const __m256 a[3], const __m256 b[3])
+	{
+		return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a[0], b[0]), _mm256_mul_ps(a[1], b[1])), _mm256_mul_ps(a[2], b[2]));
+	}
+
+	//std::max(value, 0.f), keeps -0 and NaN like it does
+	TARGET_AVX2 static __m256 MaxZero(__m256 value)
+	{
+		return _mm256_max_ps(_mm256_setzero_ps(), value);
+	}
+
+	TARGET_AVX2 static void Load(const float source[3][SPAN_WIDTH], __m256 destination[3])
+	{
+		for (int i{}; i < 3; ++i)
+		{
+			destination[i] = _mm256_load_ps(source[i]);
+		}
+	}
+
+	//Same as GetLightAttenuation in Light.h
+	TARGET_AVX2 static __m256 GetLightAttenuation(const Light& light, const __m256 toLight[3], __m256 distanceSquared)
+	{
+		const __m256 window{ _mm256_sub_ps(_mm256_set1_ps(1.f), _mm256_div_ps(distanceSquared, _mm256_set1_ps(light.range * light.range))) };
+		__m256 attenuation{ _mm256_mul_ps(window, window) };
+		if (light.type == LightType::Spot)
+		{
+			const __m256 direction[3]{ _mm256_set1_ps(light.direction.x), _mm256_set1_ps(light.direction.y), _mm256_set1_ps(light.direction.z) };
+			const __m256 cosAngle{ _mm256_xor_ps(Dot(toLight, direction), _mm256_set1_ps(-0.f)) };
+			__m256 t{ _mm256_div_ps(_mm256_sub_ps(cosAngle, _mm256_set1_ps(light.cosOuterCone)), _mm256_set1_ps(light.cosInnerCone - light.cosOuterCone)) };
+			t = _mm256_min_ps(_mm256_max_ps(t, _mm256_setzero_ps()), _mm256_set1_ps(1.f));
+			attenuation = _mm256_mul_ps(attenuation, _mm256_mul_ps(_mm256_mul_ps(t, t), _mm256_sub_ps(_mm256_set1_ps(3.f), _mm256_mul_ps(_mm256_set1_ps(2.f), t))));
+		}
+		return attenuation;
+	}
+
+	//Same as Renderer::GetWorldPosition
+	TARGET_AVX2 static void GetWorldPositions(const Matrix& screenToWorld, int firstX, int py, const float* depths, __m256 worldPosition[3])
+	{
+		const __m256 x{ _mm256_add_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(firstX), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))), _mm256_set1_ps(0.5f)) };
+		const __m256 y{ _mm256_set1_ps(static_cast<float>(py) + 0.5f) };
+		const __m256 z{ _mm256_loadu_ps(depths) };
+
+		__m256 position[4];
+		for (int i{}; i < 4; ++i)
+		{
+			position[i] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(screenToWorld[0][i]), x),
+				_mm256_mul_ps(_mm256_set1_ps(screenToWorld[1][i]), y)), _mm256_mul_ps(_mm256_set1_ps(screenToWorld[2][i]), z)), _mm256_set1_ps(screenToWorld[3][i]));
+		}
+		for (int i{}; i < 3; ++i)
+		{
+			worldPosition[i] = _mm256_div_ps(position[i], position[3]);
+		}
+	}
+
+	template<ColorMode colorMode, bool useNormalMap>
+	TARGET_AVX2 static void ShadePacketAVX2(const ShadeConstants& constants, std::span<const uint32_t> lightIndices, int firstX, int py, const float* depths, ShadePacket& packet)
+	{
+		constexpr bool needsDiffuse{ colorMode == ColorMode::Diffuse || colorMode == ColorMode::Combined };
+		constexpr bool needsSpecular{ colorMode == ColorMode::Specular || colorMode == ColorMode::Combined };
+
+		__m256 normal[3];
+		Load(packet.normal, normal);
+
+		__m256 pixelNormal[3]{ normal[0], normal[1], normal[2] };
+		if constexpr (useNormalMap)
+		{
+			//Rows of the tangent space matrix: tangent, binormal = normal x tangent, normal
+			__m256 tangent[3];
+			Load(packet.tangent, tangent);
+			const __m256 binormal[3]{
+				_mm256_sub_ps(_mm256_mul_ps(normal[1], tangent[2]), _mm256_mul_ps(normal[2], tangent[1])),
+				_mm256_sub_ps(_mm256_mul_ps(normal[2], tangent[0]), _mm256_mul_ps(normal[0], tangent[2])),
+				_mm256_sub_ps(_mm256_mul_ps(normal[0], tangent[1]), _mm256_mul_ps(normal[1], tangent[0])) };
+
+			__m256 sampled[3];
+			for (int i{}; i < 3; ++i)
+			{
+				sampled[i] = _mm256_sub_ps(_mm256_mul_ps(_mm256_load_ps(packet.sampledNormal[i]), _mm256_set1_ps(2.f)), _mm256_set1_ps(1.f));
+			}
+			for (int i{}; i < 3; ++i)
+			{
+				pixelNormal[i] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tangent[i], sampled[0]), _mm256_mul_ps(binormal[i], sampled[1])), _mm256_mul_ps(normal[i], sampled[2]));
+			}
+		}
+
+		//Whatever doesn't depend on the light
+		__m256 diffuse[3]{};
+		if constexpr (needsDiffuse)
+			Load(packet.diffuse, diffuse);
+		__m256 specularColor[3]{};
+		__m256 viewDirection[3]{};
+		__m256 gloss{};
+		__m256 exponent{};
+		if constexpr (needsSpecular)
+		{
+			Load(packet.specular, specularColor);
+			Load(packet.viewDirection, viewDirection);
+			gloss = _mm256_load_ps(packet.gloss);
+			exponent = _mm256_mul_ps(gloss, _mm256_set1_ps(constants.glossiness));
+		}
+
+		__m256 color[3]{ _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+		__m256 worldPosition[3];
+		bool hasWorldPosition{ false };
+		for (const uint32_t lightIdx : lightIndices)
+		{
+			const Light& light{ constants.pLights[lightIdx] };
+
+			__m256 toLight[3];
+			__m256 radiance[3]{ _mm256_set1_ps(light.color.r), _mm256_set1_ps(light.color.g), _mm256_set1_ps(light.color.b) };
+			__m256 isLit{};
+			if (light.type == LightType::Directional)
+			{
+				toLight[0] = _mm256_set1_ps(-light.direction.x);
+				toLight[1] = _mm256_set1_ps(-light.direction.y);
+				toLight[2] = _mm256_set1_ps(-light.direction.z);
+			}
+			else
+			{
+				if (!hasWorldPosition)
+				{
+					GetWorldPositions(constants.screenToWorld, firstX, py, depths, worldPosition);
+					hasWorldPosition = true;
+				}
+
+				const __m256 offset[3]{
+					_mm256_sub_ps(_mm256_set1_ps(light.position.x), worldPosition[0]),
+					_mm256_sub_ps(_mm256_set1_ps(light.position.y), worldPosition[1]),
+					_mm256_sub_ps(_mm256_set1_ps(light.position.z), worldPosition[2]) };
+				const __m256 distanceSquared{ Dot(offset, offset) };
+				isLit = _mm256_cmp_ps(distanceSquared, _mm256_set1_ps(light.range * light.range), _CMP_LT_OQ);
+				if (_mm256_movemask_ps(isLit) == 0)
+					continue;
+
+				const __m256 distance{ _mm256_sqrt_ps(distanceSquared) };
+				for (int i{}; i < 3; ++i)
+				{
+					toLight[i] = _mm256_div_ps(offset[i], distance);
+				}
+				const __m256 attenuation{ GetLightAttenuation(light, toLight, distanceSquared) };
+				for (int i{}; i < 3; ++i)
+				{
+					radiance[i] = _mm256_mul_ps(radiance[i], attenuation);
+				}
+			}
+
+			const __m256 observedArea{ MaxZero(Dot(toLight, pixelNormal)) };
+
+			//Phong: reflect the direction to the light around the normal, raise its cosine with the view direction to the gloss
+			__m256 phong{};
+			if constexpr (needsSpecular)
+			{
+				const __m256 scale{ _mm256_mul_ps(_mm256_set1_ps(2.f), Dot(toLight, pixelNormal)) };
+				const __m256 reflected[3]{
+					_mm256_sub_ps(toLight[0], _mm256_mul_ps(pixelNormal[0], scale)),
+					_mm256_sub_ps(toLight[1], _mm256_mul_ps(pixelNormal[1], scale)),
+					_mm256_sub_ps(toLight[2], _mm256_mul_ps(pixelNormal[2], scale)) };
+				const __m256 angle{ MaxZero(Dot(reflected, viewDirection)) };
+				phong = constants.pSpecularTable ? LookupSpecularPower(*constants.pSpecularTable, angle, gloss, exponent) : Pow(angle, exponent);
+			}
+
+			const __m256 lightIntensity{ _mm256_set1_ps(light.intensity) };
+			for (int i{}; i < 3; ++i)
+			{
+				__m256 contribution;
+				if constexpr (colorMode == ColorMode::observedArea)
+				{
+					contribution = observedArea;
+				}
+				else
+				{
+					//Lambert: diffuse * intensity / pi
+					__m256 lambert{};
+					if constexpr (needsDiffuse)
+						lambert = _mm256_div_ps(_mm256_mul_ps(diffuse[i], lightIntensity), _mm256_set1_ps(static_cast<float>(M_PI)));
+					const __m256 specular{ _mm256_mul_ps(specularColor[i], phong) };
+
+					if constexpr (colorMode == ColorMode::Diffuse)
+						contribution = _mm256_mul_ps(lambert, observedArea);
+					else if constexpr (colorMode == ColorMode::Specular)
+						contribution = specular;
+					else
+						contribution = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(lambert, lightIntensity), specular), observedArea);
+				}
+
+				//Lanes out of range get skipped like the scalar path does, even an infinite specular shouldn't reach them
+				const __m256 sum{ _mm256_add_ps(color[i], _mm256_mul_ps(contribution, radiance[i])) };
+				color[i] = light.type == LightType::Directional ? sum : _mm256_blendv_ps(color[i], sum, isLit);
+			}
+		}
+
+		//MaxToOne, std::max(a, b) is _mm256_max_ps(b, a) when it comes to NaN
+		const __m256 maxValue{ _mm256_max_ps(_mm256_max_ps(color[2], color[1]), color[0]) };
+		const __m256 isTooBright{ _mm256_cmp_ps(maxValue, _mm256_set1_ps(1.f), _CMP_GT_OQ) };
+		const bool hasTooBright{ _mm256_movemask_ps(isTooBright) != 0 };
+		for (int i{}; i < 3; ++i)
+		{
+			_mm256_store_ps(packet.color[i], hasTooBright ? _mm256_blendv_ps(color[i], _mm256_div_ps(color[i], maxValue), isTooBright) : color[i]);
+		}
+	}
+
+	void SpecularPowerTable::Build(float glossinessScale)
+	{
+		glossiness = glossinessScale;
+		values.resize(NR_GLOSS_ROWS * (NR_COSINE_STEPS + 1));
+
+		//Same rounding as the exponent the shading computes from an 8 bit gloss sample
+		firstRow = NR_GLOSS_ROWS;
+		for (int row{ NR_GLOSS_ROWS - 1 }; row >= 0 && row / 255.f * glossiness >= 1.f; --row)
+		{
+			firstRow = row;
+		}
+
+		for (int row{ firstRow }; row < NR_GLOSS_ROWS; ++row)
+		{
+			const float exponent{ row / 255.f * glossiness };
+			for (int step{}; step <= NR_COSINE_STEPS; ++step)
+			{
+				values[row * (NR_COSINE_STEPS + 1) + step] = powf(static_cast<float>(step) / NR_COSINE_STEPS, exponent);
+			}
+		}
+	}
+
+	TARGET_AVX2 static bool MatchesScalarSpecularLookupAVX2(const SpecularPowerTable& table)
+	{
+		//Both ends of the cosines, past them, and the rows on either side of firstRow
+		alignas(32) const float cosines[SPAN_WIDTH]{ 0.f, 0.25f, 0.999f, 1.f, 1.0001f, 2.f, 0.5f, 1.f };
+		const int rows[]{ 0, table.firstRow - 1, table.firstRow, 128, SpecularPowerTable::NR_GLOSS_ROWS - 1 };
+		for (const int row : rows)
+		{
+			if (row < 0 || row >= SpecularPowerTable::NR_GLOSS_ROWS)
+				continue;
+
+			const float gloss{ row / 255.f };
+			const __m256 cosine{ _mm256_load_ps(cosines) };
+			const __m256 exponent{ _mm256_set1_ps(gloss * table.glossiness) };
+			alignas(32) float lookups[SPAN_WIDTH];
+			alignas(32) float powers[SPAN_WIDTH];
+			_mm256_store_ps(lookups, LookupSpecularPower(table, cosine, _mm256_set1_ps(gloss), exponent));
+			_mm256_store_ps(powers, Pow(cosine, exponent));
+
+			for (int i{}; i < SPAN_WIDTH; ++i)
+			{
+				//Fallback lanes take the packet approximation of powf, the others have to be the scalar lookup exactly
+				const bool isFallback{ row < table.firstRow || !(cosines[i] < 1.f) };
+				if (lookups[i] != (isFallback ? powers[i] : table.Lookup(cosines[i], gloss)))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	bool MatchesScalarSpecularLookup(SimdLevel simdLevel, const SpecularPowerTable& table)
+	{
+		return simdLevel != SimdLevel::AVX2 || MatchesScalarSpecularLookupAVX2(table);
+	}
+
+	template<ColorMode colorMode>
+	static InterpolatePacketFunction GetInterpolatePacketFunction(bool useNormalMap)
+	{
+		return useNormalMap ? InterpolatePacketAVX2<colorMode, true> : InterpolatePacketAVX2<colorMode, false>;
+	}
+
+	template<ColorMode colorMode>
+	static ShadePacketFunction GetShadePacketFunction(bool useNormalMap)
+	{
+		return useNormalMap ? ShadePacketAVX2<colorMode, true> : ShadePacketAVX2<colorMode, false>;
+	}
+
+	InterpolatePacketFunction GetInterpolatePacketFunction(SimdLevel simdLevel, ColorMode colorMode, bool useNormalMap)
+	{
+		if (simdLevel != SimdLevel::AVX2)
+			return nullptr;
+
+		switch (colorMode)
+		{
+		case ColorMode::Diffuse:
+			return GetInterpolatePacketFunction<ColorMode::Diffuse>(useNormalMap);
+		case ColorMode::Specular:
+			return GetInterpolatePacketFunction<ColorMode::Specular>(useNormalMap);
+		case ColorMode::Combined:
+			return GetInterpolatePacketFunction<ColorMode::Combined>(useNormalMap);
+		default:
+			return GetInterpolatePacketFunction<ColorMode::observedArea>(useNormalMap);
+		}
+	}
+
+	ShadePacketFunction GetShadePacketFunction(SimdLevel simdLevel, ColorMode colorMode, bool useNormalMap)
+	{
+		if (simdLevel != SimdLevel::AVX2)
+			return nullptr;
+
+		switch (colorMode)
+		{
+		case ColorMode::Diffuse:
+			return GetShadePacketFunction<ColorMode::Diffuse>(useNormalMap);
+		case ColorMode::Specular:
+			return GetShadePacketFunction<ColorMode::Specular>(useNormalMap);
+		case ColorMode::Combined:
+			return GetShadePacketFunction<ColorMode::Combined>(useNormalMap);
+		default:
+			return GetShadePacketFunction<ColorMode::observedArea>(useNormalMap);
+		}
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "DataTypes.h"
+#include "Light.h"
+#include "RasterKernels.h"
+
+namespace dae
+{
+	enum class ColorMode
+	{
+		observedArea,
+		Diffuse,
+		Specular,
+		Combined
+	};
+
+	//Up to SPAN_WIDTH fragments of one triangle, structure of arrays, lane i is pixel firstX + i of a span
+	struct ShadePacket
+	{
+		//Filled in by the interpolate kernel, only the attributes the color mode reads
+		alignas(32) float uv[2][SPAN_WIDTH];
+		alignas(32) float normal[3][SPAN_WIDTH];
+		alignas(32) float tangent[3][SPAN_WIDTH];
+		alignas(32) float viewDirection[3][SPAN_WIDTH];
+
+		//Texture samples, filled in by the caller
+		alignas(32) float diffuse[3][SPAN_WIDTH]; //already multiplied by the instance tint
+		alignas(32) float specular[3][SPAN_WIDTH];
+		alignas(32) float gloss[SPAN_WIDTH];
+		alignas(32) float sampledNormal[3][SPAN_WIDTH]; //normal map, still in [0, 1]
+
+		//Output of the shade kernel, already scaled down like ColorRGB::MaxToOne
+		alignas(32) float color[3][SPAN_WIDTH];
+	};
+
+	//powf(cosine, gloss * glossiness) with one row per 8 bit gloss value (the gloss texture has no other values), each row holds
+	//NR_COSINE_STEPS + 1 evenly spaced cosines in [0, 1] to interpolate linearly between. Up to an exponent of 32 the result
+	//stays within 5e-4 of powf
+	//Exponents below 1 are too steep near a cosine of 0 for that, their rows (and cosines of 1 and up) fall back to powf
+	struct SpecularPowerTable
+	{
+		static constexpr int NR_GLOSS_ROWS{ 256 };
+		static constexpr int NR_COSINE_STEPS{ 512 };
+
+		//What the table was built for, the exponent is gloss * glossiness
+		float glossiness{};
+		//Rows below this one aren't in the table
+		int firstRow{};
+		std::vector<float> values{};
+
+		void Build(float glossinessScale);
+
+		static int GetRow(float gloss)
+		{
+			return static_cast<int>(gloss * 255.f + 0.5f);
+		}
+
+		float Lookup(float cosine, float gloss) const
+		{
+			const int row{ GetRow(gloss) };
+			if (row < firstRow || row >= NR_GLOSS_ROWS || !(cosine < 1.f))
+				return powf(cosine, gloss * glossiness);
+
+			const float position{ cosine * NR_COSINE_STEPS };
+			const int step{ static_cast<int>(position) };
+			const float t{ position - static_cast<float>(step) };
+			const float* pValues{ values.data() + row * (NR_COSINE_STEPS + 1) + step };
+			return pValues[0] + (pValues[1] - pValues[0]) * t;
+		}
+	};
+
+	//Same for every packet of a frame
+	struct ShadeConstants
+	{
+		//What the light indices of the tiles point into
+		const Light* pLights{};
+		float glossiness{};
+		//nullptr: the exact specular power (scalar) or its polynomial approximation (packets)
+		const SpecularPowerTable* pSpecularTable{};
+		//Pixel centre and depth buffer value (x, y, depth, 1) to world space (before the divide by w)
+		Matrix screenToWorld{};
+	};
+
+	//origin: first vertex of the snapped triangle, offsets are taken from the pixel centres like Renderer::ShadePixel does
+	using InterpolatePacketFunction = void(*)(const TriangleSetup& setup, const Vector2& origin, int firstX, int py, ShadePacket& packet);
+	//lightIndices: the lights of the screen tile the packet lies in, depths: the depth of every lane
+	using ShadePacketFunction = void(*)(const ShadeConstants& constants, std::span<const uint32_t> lightIndices, int firstX, int py, const float* depths, ShadePacket& packet);
+
+	//Interpolation rounds exactly like the scalar path. Shading does too, except for the specular power: without a table that
+	//one uses exp2(exponent * log2(angle)) with polynomial approximations, within a relative error of 2e-6 for every result
+	//above 1 / 255. After the conversion to 8 bits a channel can end up at most 1 step away from the scalar path
+	//With a table the lookups match the scalar ones, only the powf fallback uses the approximation
+	//Both return nullptr below AVX2, a packet is 8 lanes wide
+	InterpolatePacketFunction GetInterpolatePacketFunction(SimdLevel simdLevel, ColorMode colorMode, bool useNormalMap);
+	ShadePacketFunction GetShadePacketFunction(SimdLevel simdLevel, ColorMode colorMode, bool useNormalMap);
+	//Self check of the packet table lookup against SpecularPowerTable::Lookup at the edges of the table, true below AVX2
+	bool MatchesScalarSpecularLookup(SimdLevel simdLevel, const SpecularPowerTable& table);
+}
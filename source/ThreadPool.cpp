@@ -0,0 +1,100 @@
+#include "ThreadPool.h"
+using namespace dae;
+
+ThreadPool::ThreadPool(uint32_t nrThreads)
+{
+	//hardware_concurrency is allowed to return 0 when it can't tell
+	const uint32_t nrWorkers{ nrThreads > 1 ? nrThreads - 1 : 0 };
+
+	m_Workers.reserve(nrWorkers);
+	for (uint32_t i{}; i < nrWorkers; ++i)
+	{
+		m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_IsStopping = true;
+	}
+	m_WorkAvailable.notify_all();
+
+	for (std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& job)
+{
+	if (count == 0)
+		return;
+
+	//Not worth waking anyone up
+	if (m_Workers.empty() || count == 1)
+	{
+		for (uint32_t i{}; i < count; ++i)
+		{
+			job(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_pJob = &job;
+		m_JobCount = count;
+		m_NextJobIndex = 0;
+		m_BusyWorkers = static_cast<uint32_t>(m_Workers.size());
+		++m_Generation;
+	}
+	m_WorkAvailable.notify_all();
+
+	ExecuteJobs(job, count);
+
+	std::unique_lock<std::mutex> lock{ m_Mutex };
+	m_WorkDone.wait(lock, [this] { return m_BusyWorkers == 0; });
+	m_pJob = nullptr;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	uint64_t handledGeneration{};
+
+	while (true)
+	{
+		const std::function<void(uint32_t)>* pJob{ nullptr };
+		uint32_t count{};
+		{
+			std::unique_lock<std::mutex> lock{ m_Mutex };
+			m_WorkAvailable.wait(lock, [&] { return m_IsStopping || m_Generation != handledGeneration; });
+
+			if (m_IsStopping)
+				return;
+
+			handledGeneration = m_Generation;
+			pJob = m_pJob;
+			count = m_JobCount;
+		}
+
+		ExecuteJobs(*pJob, count);
+
+		bool isLastWorker{};
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			isLastWorker = --m_BusyWorkers == 0;
+		}
+		if (isLastWorker)
+			m_WorkDone.notify_one();
+	}
+}
+
+void ThreadPool::ExecuteJobs(const std::function<void(uint32_t)>& job, uint32_t count)
+{
+	for (uint32_t index{ m_NextJobIndex++ }; index < count; index = m_NextJobIndex++)
+	{
+		job(index);
+	}
+}
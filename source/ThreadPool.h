@@ -0,0 +1,48 @@
+#pragma once
+
+//Standard includes
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	class ThreadPool final
+	{
+	public:
+		//nrThreads includes the calling thread, so nrThreads - 1 workers get spawned
+		explicit ThreadPool(uint32_t nrThreads = std::thread::hardware_concurrency());
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) noexcept = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+		//Calls job(index) for every index in [0, count) and blocks until all of them are done
+		//The calling thread takes jobs as well, indices are handed out one at a time
+		void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& job);
+		uint32_t GetNrThreads() const { return static_cast<uint32_t>(m_Workers.size()) + 1; };
+
+	private:
+		std::vector<std::thread> m_Workers{};
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_WorkAvailable{};
+		std::condition_variable m_WorkDone{};
+
+		const std::function<void(uint32_t)>* m_pJob{ nullptr };
+		uint32_t m_JobCount{};
+		std::atomic<uint32_t> m_NextJobIndex{};
+		uint32_t m_BusyWorkers{};
+		uint64_t m_Generation{};
+		bool m_IsStopping{ false };
+
+		void WorkerLoop();
+		void ExecuteJobs(const std::function<void(uint32_t)>& job, uint32_t count);
+	};
+}
@@ -1,9 +1,13 @@
 #pragma once
 #include <cassert>
+#include <cfloat>
+#include <cmath>
 #include <fstream>
 #include "Math.h"
 #include "DataTypes.h"
 #include <algorithm>
+#include <iostream>
+#include <unordered_map>
 
 //#define DISABLE_OBJ
 
@@ -11,7 +15,31 @@ namespace dae
 {
 	namespace Utils
 	{
-		//Just parses vertices and indices
+		//OBJ indices (1-based, 0 = not given) of one face corner, identical corners share a vertex
+		struct ObjVertexKey
+		{
+			size_t position{};
+			size_t uv{};
+			size_t normal{};
+
+			bool operator==(const ObjVertexKey& other) const
+			{
+				return position == other.position && uv == other.uv && normal == other.normal;
+			}
+		};
+
+		struct ObjVertexKeyHash
+		{
+			size_t operator()(const ObjVertexKey& key) const
+			{
+				size_t hash{ std::hash<size_t>{}(key.position) };
+				hash ^= std::hash<size_t>{}(key.uv) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+				hash ^= std::hash<size_t>{}(key.normal) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+				return hash;
+			}
+		};
+
+		//Just parses vertices and indices, face corners with the same position/uv/normal indices share one vertex
 #pragma warning(push)
 #pragma warning(disable : 4505) //Warning unreferenced local function
 		static bool ParseOBJ(const std::string& filename, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool flipAxisAndWinding = true)
@@ -35,6 +63,8 @@ namespace dae
 			vertices.clear();
 			indices.clear();
 
+			std::unordered_map<ObjVertexKey, uint32_t, ObjVertexKeyHash> vertexLookup{};
+
 			std::string sCommand;
 			// start a while iteration ending when the end of file is reached (ios::eof)
 			while (!file.eof())
@@ -78,7 +108,8 @@ namespace dae
 					//
 					// Faces or triangles
 					Vertex vertex{};
-					size_t iPosition, iTexCoord, iNormal;
+					//Like the vertex, these carry over to the next corner when it leaves them out
+					size_t iPosition{}, iTexCoord{}, iNormal{};
 
 					uint32_t tempIndices[3];
 					for (size_t iFace = 0; iFace < 3; iFace++)
@@ -108,9 +139,11 @@ namespace dae
 							}
 						}
 
-						vertices.push_back(vertex);
-						tempIndices[iFace] = uint32_t(vertices.size()) - 1;
-						//indices.push_back(uint32_t(vertices.size()) - 1);
+						const auto [it, isNewVertex] { vertexLookup.try_emplace(ObjVertexKey{ iPosition, iTexCoord, iNormal }, uint32_t(vertices.size())) };
+						if (isNewVertex)
+							vertices.push_back(vertex);
+
+						tempIndices[iFace] = it->second;
 					}
 
 					indices.push_back(tempIndices[0]);
@@ -147,7 +180,12 @@ namespace dae
 				const Vector3 edge1 = p2 - p0;
 				const Vector2 diffX = Vector2(uv1.x - uv0.x, uv2.x - uv0.x);
 				const Vector2 diffY = Vector2(uv1.y - uv0.y, uv2.y - uv0.y);
-				float r = 1.f / Vector2::Cross(diffX, diffY);
+				const float uvArea = Vector2::Cross(diffX, diffY);
+
+				//Shared vertices would spread the inf/nan of a degenerate uv mapping to all their triangles
+				if (uvArea == 0.f)
+					continue;
+				float r = 1.f / uvArea;
 
 				Vector3 tangent = (edge0 * diffY.y - edge1 * diffY.x) * r;
 				vertices[index0].tangent += tangent;
@@ -155,7 +193,7 @@ namespace dae
 				vertices[index2].tangent += tangent;
 			}
 
-			//Fix the tangents per vertex now because we accumulated
+			//Fix the tangents per vertex now because we accumulated (over every triangle sharing the vertex)
 			for (auto& v : vertices)
 			{
 				v.tangent = Vector3::Reject(v.tangent, v.normal).Normalized();
@@ -173,6 +211,931 @@ namespace dae
 #endif
 		}
 
+		//Average cache miss ratio (transformed vertices per triangle) of a triangle list with a FIFO post-transform cache
+		static float CalculateACMR(const std::vector<uint32_t>& indices, size_t nrVertices, uint32_t cacheSize)
+		{
+			if (indices.size() < 3)
+				return 0.f;
+
+			//A vertex is in the cache while fewer than cacheSize misses happened since it got loaded
+			std::vector<uint32_t> loadTimes(nrVertices, 0);
+			uint32_t nrMisses{};
+			for (uint32_t index : indices)
+			{
+				if (loadTimes[index] == 0 || nrMisses - loadTimes[index] >= cacheSize)
+				{
+					++nrMisses;
+					loadTimes[index] = nrMisses;
+				}
+			}
+			return static_cast<float>(nrMisses) / static_cast<float>(indices.size() / 3);
+		}
+
+		//Tipsify (Sander, Nehab and Barczak 2007): reorders a triangle list for post-transform cache reuse
+		//Fans around the current vertex, then continues with the cached neighbour that will stay in the cache longest
+		static void ReorderTrianglesTipsify(std::vector<uint32_t>& indices, size_t nrVertices, uint32_t cacheSize)
+		{
+			const size_t nrTriangles{ indices.size() / 3 };
+
+			//Triangles using every vertex
+			std::vector<uint32_t> nrLiveTriangles(nrVertices, 0);
+			for (size_t i{}; i < nrTriangles * 3; ++i)
+			{
+				++nrLiveTriangles[indices[i]];
+			}
+			std::vector<uint32_t> adjacencyOffsets(nrVertices + 1, 0);
+			for (size_t v{}; v < nrVertices; ++v)
+			{
+				adjacencyOffsets[v + 1] = adjacencyOffsets[v] + nrLiveTriangles[v];
+			}
+			std::vector<uint32_t> adjacency(nrTriangles * 3);
+			std::vector<uint32_t> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i{}; i < nrTriangles * 3; ++i)
+			{
+				adjacency[fillOffsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+
+			std::vector<uint32_t> cacheTimes(nrVertices, 0);
+			std::vector<bool> isEmitted(nrTriangles, false);
+			std::vector<uint32_t> deadEndStack{};
+			std::vector<uint32_t> candidates{};
+			std::vector<uint32_t> reordered{};
+			reordered.reserve(nrTriangles * 3);
+
+			uint32_t time{ cacheSize + 1 };
+			size_t cursor{};
+			int64_t fanningVertex{ nrVertices > 0 ? 0 : -1 };
+
+			while (fanningVertex >= 0)
+			{
+				candidates.clear();
+
+				const uint32_t vertex{ static_cast<uint32_t>(fanningVertex) };
+				for (uint32_t a{ adjacencyOffsets[vertex] }; a < adjacencyOffsets[vertex + 1]; ++a)
+				{
+					const uint32_t triangle{ adjacency[a] };
+					if (isEmitted[triangle])
+						continue;
+
+					for (int corner{}; corner < 3; ++corner)
+					{
+						const uint32_t v{ indices[triangle * 3 + corner] };
+						reordered.push_back(v);
+						deadEndStack.push_back(v);
+						candidates.push_back(v);
+						--nrLiveTriangles[v];
+
+						if (time - cacheTimes[v] > cacheSize)
+						{
+							cacheTimes[v] = time;
+							++time;
+						}
+					}
+					isEmitted[triangle] = true;
+				}
+
+				//Next fanning vertex: the candidate that stays in the cache longest while its remaining triangles get emitted
+				fanningVertex = -1;
+				int64_t bestPriority{ -1 };
+				for (uint32_t v : candidates)
+				{
+					if (nrLiveTriangles[v] == 0)
+						continue;
+
+					int64_t priority{};
+					if (time - cacheTimes[v] + 2 * nrLiveTriangles[v] <= cacheSize)
+						priority = time - cacheTimes[v];
+
+					if (priority > bestPriority)
+					{
+						bestPriority = priority;
+						fanningVertex = v;
+					}
+				}
+
+				//Dead end: go back to recently used vertices, then to the next vertex in input order
+				while (fanningVertex < 0 && !deadEndStack.empty())
+				{
+					const uint32_t v{ deadEndStack.back() };
+					deadEndStack.pop_back();
+					if (nrLiveTriangles[v] > 0)
+						fanningVertex = v;
+				}
+				while (fanningVertex < 0 && cursor < nrVertices)
+				{
+					if (nrLiveTriangles[cursor] > 0)
+						fanningVertex = static_cast<int64_t>(cursor);
+					++cursor;
+				}
+			}
+
+			indices.swap(reordered);
+		}
+
+		//Renumbers the vertices in the order the indices first use them, so vertex fetches mostly walk forward
+		//Unreferenced vertices end up at the back
+		static void ReorderVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+		{
+			constexpr uint32_t unassigned{ UINT32_MAX };
+			std::vector<uint32_t> remap(vertices.size(), unassigned);
+			std::vector<Vertex> reordered{};
+			reordered.reserve(vertices.size());
+
+			for (uint32_t& index : indices)
+			{
+				if (remap[index] == unassigned)
+				{
+					remap[index] = static_cast<uint32_t>(reordered.size());
+					reordered.push_back(vertices[index]);
+				}
+				index = remap[index];
+			}
+			for (size_t v{}; v < vertices.size(); ++v)
+			{
+				if (remap[v] == unassigned)
+					reordered.push_back(vertices[v]);
+			}
+
+			vertices.swap(reordered);
+		}
+
+		constexpr uint32_t VERTEX_CACHE_SIZE{ 16 };
+
+		//Load time optimization of a triangle list: triangle order for the post-transform cache, then vertex order for fetching
+		//BuildMeshlets regroups the triangles afterwards and redoes the triangle order inside every meshlet
+		static void OptimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t cacheSize = VERTEX_CACHE_SIZE)
+		{
+			ReorderTrianglesTipsify(indices, vertices.size(), cacheSize);
+			ReorderVertices(vertices, indices);
+		}
+
+		constexpr uint32_t MESHLET_MAX_VERTICES{ 64 };
+		constexpr uint32_t MESHLET_MAX_TRIANGLES{ 124 };
+
+		static void CalculateMeshletBounds(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, Meshlet& meshlet)
+		{
+			const uint32_t endIndex{ meshlet.firstIndex + meshlet.nrIndices };
+
+			//Sphere around the centre of the bounding box
+			Vector3 minPosition{ vertices[indices[meshlet.firstIndex]].position };
+			Vector3 maxPosition{ minPosition };
+			for (uint32_t i{ meshlet.firstIndex }; i < endIndex; ++i)
+			{
+				const Vector3& position{ vertices[indices[i]].position };
+				for (int axis{}; axis < 3; ++axis)
+				{
+					minPosition[axis] = std::min(minPosition[axis], position[axis]);
+					maxPosition[axis] = std::max(maxPosition[axis], position[axis]);
+				}
+			}
+			meshlet.center = (minPosition + maxPosition) * 0.5f;
+
+			float sqrRadius{};
+			for (uint32_t i{ meshlet.firstIndex }; i < endIndex; ++i)
+			{
+				sqrRadius = std::max(sqrRadius, (vertices[indices[i]].position - meshlet.center).SqrMagnitude());
+			}
+			meshlet.radius = sqrtf(sqrRadius);
+
+			//Normal cone around the average face normal, degenerate triangles never get drawn so they don't count
+			Vector3 faceNormals[MESHLET_MAX_TRIANGLES]{};
+			uint32_t nrFaceNormals{};
+			Vector3 normalSum{};
+			for (uint32_t i{ meshlet.firstIndex }; i < endIndex; i += 3)
+			{
+				const Vector3& p0{ vertices[indices[i]].position };
+				const Vector3 faceNormal{ Vector3::Cross(vertices[indices[i + 1]].position - p0, vertices[indices[i + 2]].position - p0) };
+				const float magnitude{ faceNormal.Magnitude() };
+				if (magnitude == 0.f)
+					continue;
+
+				faceNormals[nrFaceNormals] = faceNormal / magnitude;
+				normalSum += faceNormals[nrFaceNormals];
+				++nrFaceNormals;
+			}
+
+			meshlet.coneCutoff = 1.f;
+			const float sumMagnitude{ normalSum.Magnitude() };
+			if (nrFaceNormals == 0 || sumMagnitude < 1e-6f)
+				return;
+
+			meshlet.coneAxis = normalSum / sumMagnitude;
+			float minDot{ 1.f };
+			for (uint32_t i{}; i < nrFaceNormals; ++i)
+			{
+				minDot = std::min(minDot, Vector3::Dot(meshlet.coneAxis, faceNormals[i]));
+			}
+
+			//Normals more than 90 degrees apart, the cluster always has a face looking at the camera
+			if (minDot <= 0.f)
+				return;
+
+			meshlet.coneCutoff = sqrtf(1.f - minDot * minDot);
+		}
+
+		//Splits a triangle list into meshlets and reorders the triangles so every meshlet is a consecutive range of indices
+		//A meshlet grows over shared vertices: the next triangle is the neighbour that adds the fewest vertices,
+		//with a penalty for normals far from the meshlet's average. Triangles whose normal is further than
+		//minNormalDot from that average start a new meshlet, so the normal cones stay narrow enough to cull
+		//The triangles inside every meshlet get reordered for the post-transform cache afterwards
+		static void BuildMeshlets(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<Meshlet>& meshlets, float minNormalDot = 0.9f, float coneWeight = 2.f,
+			uint32_t cacheSize = VERTEX_CACHE_SIZE)
+		{
+			meshlets.clear();
+			const uint32_t nrTriangles{ static_cast<uint32_t>(indices.size() / 3) };
+
+			std::vector<Vector3> faceNormals(nrTriangles);
+			for (uint32_t t{}; t < nrTriangles; ++t)
+			{
+				const Vector3& p0{ vertices[indices[t * 3]].position };
+				const Vector3 faceNormal{ Vector3::Cross(vertices[indices[t * 3 + 1]].position - p0, vertices[indices[t * 3 + 2]].position - p0) };
+				const float magnitude{ faceNormal.Magnitude() };
+				faceNormals[t] = magnitude > 0.f ? faceNormal / magnitude : Vector3{};
+			}
+
+			//Triangles using every vertex
+			std::vector<uint32_t> adjacencyOffsets(vertices.size() + 1, 0);
+			for (uint32_t i{}; i < nrTriangles * 3; ++i)
+			{
+				++adjacencyOffsets[indices[i] + 1];
+			}
+			for (size_t v{}; v < vertices.size(); ++v)
+			{
+				adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+			}
+			std::vector<uint32_t> adjacency(nrTriangles * 3);
+			std::vector<uint32_t> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (uint32_t i{}; i < nrTriangles * 3; ++i)
+			{
+				adjacency[fillOffsets[indices[i]]++] = i / 3;
+			}
+
+			constexpr uint32_t unassigned{ UINT32_MAX };
+			std::vector<uint32_t> triangleMeshlets(nrTriangles, unassigned);
+			//Meshlet a vertex / candidate triangle was last counted in
+			std::vector<uint32_t> vertexTags(vertices.size(), unassigned);
+			std::vector<uint32_t> candidateTags(nrTriangles, unassigned);
+			std::vector<uint32_t> candidates{};
+
+			std::vector<uint32_t> reordered{};
+			reordered.reserve(indices.size());
+			uint32_t seedCursor{};
+
+			//How far ahead (in triangles) a meshlet can jump to when it runs out of neighbours
+			constexpr uint32_t jumpWindow{ 256 };
+
+			//Degenerate triangles never get drawn, they fit anywhere
+			const auto calculateNormalDot = [&](const Vector3& averageNormal, uint32_t triangle)
+				{
+					if (averageNormal.SqrMagnitude() == 0.f || faceNormals[triangle].SqrMagnitude() == 0.f)
+						return 1.f;
+					return Vector3::Dot(averageNormal, faceNormals[triangle]);
+				};
+
+			while (true)
+			{
+				//Seeds go in index order, which keeps an optimized mesh mostly in its cache friendly order
+				while (seedCursor < nrTriangles && triangleMeshlets[seedCursor] != unassigned)
+				{
+					++seedCursor;
+				}
+				if (seedCursor == nrTriangles)
+					break;
+
+				const uint32_t meshletIdx{ static_cast<uint32_t>(meshlets.size()) };
+				Meshlet meshlet{ static_cast<uint32_t>(reordered.size()), 0 };
+				uint32_t nrVertices{};
+				Vector3 normalSum{};
+				candidates.clear();
+				candidates.push_back(seedCursor);
+				candidateTags[seedCursor] = meshletIdx;
+
+				while (meshlet.nrIndices / 3 < MESHLET_MAX_TRIANGLES)
+				{
+					const Vector3 averageNormal{ normalSum.SqrMagnitude() > 0.f ? normalSum.Normalized() : Vector3{} };
+
+					//Best candidate that still fits
+					size_t bestCandidate{ candidates.size() };
+					float bestScore{ FLT_MAX };
+					for (size_t c{}; c < candidates.size(); ++c)
+					{
+						const uint32_t t{ candidates[c] };
+						if (triangleMeshlets[t] != unassigned)
+							continue;
+
+						const uint32_t* pTriangle{ &indices[t * 3] };
+						uint32_t nrNewVertices{};
+						nrNewVertices += vertexTags[pTriangle[0]] != meshletIdx;
+						nrNewVertices += vertexTags[pTriangle[1]] != meshletIdx && pTriangle[1] != pTriangle[0];
+						nrNewVertices += vertexTags[pTriangle[2]] != meshletIdx && pTriangle[2] != pTriangle[0] && pTriangle[2] != pTriangle[1];
+						if (nrVertices + nrNewVertices > MESHLET_MAX_VERTICES)
+							continue;
+
+						const float dot{ calculateNormalDot(averageNormal, t) };
+						if (dot < minNormalDot)
+							continue;
+
+						const float score{ static_cast<float>(nrNewVertices) + coneWeight * (1.f - dot) };
+						if (score < bestScore)
+						{
+							bestScore = score;
+							bestCandidate = c;
+						}
+					}
+					//Out of neighbours (meshes are often many small disconnected parts): jump to a nearby (in index order)
+					//triangle facing roughly the same way, so the normal cone stays narrow
+					if (bestCandidate == candidates.size())
+					{
+						while (seedCursor < nrTriangles && triangleMeshlets[seedCursor] != unassigned)
+						{
+							++seedCursor;
+						}
+
+						uint32_t bestJump{ unassigned };
+						float bestDot{ minNormalDot - FLT_EPSILON };
+						for (uint32_t t{ seedCursor }; t < std::min(seedCursor + jumpWindow, nrTriangles); ++t)
+						{
+							if (triangleMeshlets[t] != unassigned || candidateTags[t] == meshletIdx)
+								continue;
+
+							const float dot{ calculateNormalDot(averageNormal, t) };
+							if (dot > bestDot)
+							{
+								bestDot = dot;
+								bestJump = t;
+							}
+						}
+						if (bestJump == unassigned)
+							break;
+
+						candidateTags[bestJump] = meshletIdx;
+						candidates.push_back(bestJump);
+						continue;
+					}
+
+					const uint32_t triangle{ candidates[bestCandidate] };
+					candidates[bestCandidate] = candidates.back();
+					candidates.pop_back();
+
+					triangleMeshlets[triangle] = meshletIdx;
+					normalSum += faceNormals[triangle];
+					meshlet.nrIndices += 3;
+					for (int corner{}; corner < 3; ++corner)
+					{
+						const uint32_t v{ indices[triangle * 3 + corner] };
+						reordered.push_back(v);
+						if (vertexTags[v] == meshletIdx)
+							continue;
+
+						vertexTags[v] = meshletIdx;
+						++nrVertices;
+
+						//Its other triangles become candidates
+						for (uint32_t a{ adjacencyOffsets[v] }; a < adjacencyOffsets[v + 1]; ++a)
+						{
+							const uint32_t neighbour{ adjacency[a] };
+							if (triangleMeshlets[neighbour] == unassigned && candidateTags[neighbour] != meshletIdx)
+							{
+								candidateTags[neighbour] = meshletIdx;
+								candidates.push_back(neighbour);
+							}
+						}
+					}
+				}
+
+				meshlets.push_back(meshlet);
+			}
+
+			indices.swap(reordered);
+
+			//Tipsify on the meshlet's own vertices, it only moves triangles within their meshlet
+			std::vector<uint32_t> meshletVertices{};
+			std::vector<uint32_t> localIndices{};
+			for (Meshlet& meshlet : meshlets)
+			{
+				meshletVertices.clear();
+				localIndices.resize(meshlet.nrIndices);
+				for (uint32_t i{}; i < meshlet.nrIndices; ++i)
+				{
+					const uint32_t index{ indices[meshlet.firstIndex + i] };
+					const auto it{ std::find(meshletVertices.begin(), meshletVertices.end(), index) };
+					localIndices[i] = static_cast<uint32_t>(it - meshletVertices.begin());
+					if (it == meshletVertices.end())
+						meshletVertices.push_back(index);
+				}
+
+				ReorderTrianglesTipsify(localIndices, meshletVertices.size(), cacheSize);
+				for (uint32_t i{}; i < meshlet.nrIndices; ++i)
+				{
+					indices[meshlet.firstIndex + i] = meshletVertices[localIndices[i]];
+				}
+
+				CalculateMeshletBounds(vertices, indices, meshlet);
+			}
+		}
+
+		//Symmetric 4x4 error quadric (Garland and Heckbert 1997) of weighted planes
+		//Evaluate gives the weighted mean of the squared distances to those planes
+		struct Quadric
+		{
+			double a00{}, a01{}, a02{}, a03{};
+			double a11{}, a12{}, a13{};
+			double a22{}, a23{};
+			double a33{};
+			double weight{};
+
+			//Plane a * x + b * y + c * z + d = 0, (a, b, c) has to be unit length
+			static Quadric FromPlane(const Vector3& normal, float distance, double weight)
+			{
+				const double a{ normal.x }, b{ normal.y }, c{ normal.z }, d{ distance };
+				return Quadric{ weight * a * a, weight * a * b, weight * a * c, weight * a * d, weight * b * b, weight * b * c, weight * b * d,
+					weight * c * c, weight * c * d, weight * d * d, weight };
+			}
+
+			Quadric& operator+=(const Quadric& q)
+			{
+				a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+				a11 += q.a11; a12 += q.a12; a13 += q.a13;
+				a22 += q.a22; a23 += q.a23;
+				a33 += q.a33;
+				weight += q.weight;
+				return *this;
+			}
+
+			double Evaluate(const Vector3& p) const
+			{
+				if (weight <= 0.0)
+					return 0.0;
+
+				const double x{ p.x }, y{ p.y }, z{ p.z };
+				const double error{ a00 * x * x + a11 * y * y + a22 * z * z + a33
+					+ 2 * (a01 * x * y + a02 * x * z + a12 * y * z + a03 * x + a13 * y + a23 * z) };
+				return std::max(error, 0.0) / weight;
+			}
+		};
+
+		//Number of triangles using every edge, keyed by the two vertex ids (smallest first), see MeshSimplifier
+		static void CountEdges(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& positionIds, std::unordered_map<uint64_t, uint32_t>& edgeCounts)
+		{
+			edgeCounts.clear();
+			for (size_t i{}; i + 2 < indices.size(); i += 3)
+			{
+				for (int corner{}; corner < 3; ++corner)
+				{
+					const uint32_t a{ positionIds[indices[i + corner]] };
+					const uint32_t b{ positionIds[indices[i + (corner + 1) % 3]] };
+					++edgeCounts[(static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b)];
+				}
+			}
+		}
+
+		//Quadric error metric simplification (Garland and Heckbert 1997) with half-edge collapses: a vertex only ever merges
+		//into a neighbour and never moves, so the result indexes the same vertex buffer as the input
+		//Vertices with the same position (uv and normal seams) collapse together, border vertices only along the border
+		//Keeps its state between calls to Simplify, so every call continues from the last result while the error
+		//stays measured against the original triangles
+		struct MeshSimplifier
+		{
+			MeshSimplifier(const std::vector<Vertex>& _vertices, const std::vector<uint32_t>& indices)
+				: vertices{ _vertices }
+				, simplified{ indices }
+			{
+				const uint32_t nrVertices{ static_cast<uint32_t>(vertices.size()) };
+
+				//positionIds: first vertex with the same position, the vertices sharing one position form a ring through nextWedges
+				positionIds.resize(nrVertices);
+				nextWedges.resize(nrVertices);
+				{
+					std::vector<uint32_t> sorted(nrVertices);
+					for (uint32_t v{}; v < nrVertices; ++v)
+					{
+						sorted[v] = v;
+					}
+					const auto isLess = [&](uint32_t a, uint32_t b)
+						{
+							const Vector3& pa{ vertices[a].position };
+							const Vector3& pb{ vertices[b].position };
+							if (pa.x != pb.x)
+								return pa.x < pb.x;
+							if (pa.y != pb.y)
+								return pa.y < pb.y;
+							return pa.z < pb.z;
+						};
+					std::sort(sorted.begin(), sorted.end(), [&](uint32_t a, uint32_t b) { return isLess(a, b) || (!isLess(b, a) && a < b); });
+
+					for (uint32_t first{}; first < nrVertices;)
+					{
+						uint32_t last{ first + 1 };
+						while (last < nrVertices && !isLess(sorted[first], sorted[last]))
+						{
+							++last;
+						}
+						for (uint32_t i{ first }; i < last; ++i)
+						{
+							positionIds[sorted[i]] = sorted[first];
+							nextWedges[sorted[i]] = sorted[i + 1 < last ? i + 1 : first];
+						}
+						first = last;
+					}
+				}
+
+				std::unordered_map<uint64_t, uint32_t> edgeCounts{};
+				CountEdges(indices, positionIds, edgeCounts);
+
+				//Planes of the triangles around every position, weighted by area. Border edges add a plane perpendicular
+				//to their triangle (weighted by the squared edge length) so the border doesn't get eaten away
+				quadrics.resize(nrVertices);
+				planeIds.resize(nrVertices);
+				distances.resize(nrVertices);
+				for (size_t i{}; i + 2 < indices.size(); i += 3)
+				{
+					const uint32_t ids[3]{ positionIds[indices[i]], positionIds[indices[i + 1]], positionIds[indices[i + 2]] };
+					const Vector3 p[3]{ vertices[ids[0]].position, vertices[ids[1]].position, vertices[ids[2]].position };
+
+					Vector3 normal{ Vector3::Cross(p[1] - p[0], p[2] - p[0]) };
+					const float magnitude{ normal.Magnitude() };
+					if (magnitude == 0.f)
+						continue;
+					normal /= magnitude;
+
+					const uint32_t planeId{ static_cast<uint32_t>(planes.size()) };
+					planes.emplace_back(normal, -Vector3::Dot(normal, p[0]));
+					const Quadric quadric{ Quadric::FromPlane(normal, planes.back().w, magnitude * 0.5) };
+					for (int corner{}; corner < 3; ++corner)
+					{
+						quadrics[ids[corner]] += quadric;
+						planeIds[ids[corner]].push_back(planeId);
+
+						const int next{ (corner + 1) % 3 };
+						if (edgeCounts[(static_cast<uint64_t>(std::min(ids[corner], ids[next])) << 32) | std::max(ids[corner], ids[next])] != 1)
+							continue;
+
+						Vector3 borderNormal{ Vector3::Cross(p[next] - p[corner], normal) };
+						const float borderMagnitude{ borderNormal.Magnitude() };
+						if (borderMagnitude == 0.f)
+							continue;
+						borderNormal /= borderMagnitude;
+
+						const uint32_t borderPlaneId{ static_cast<uint32_t>(planes.size()) };
+						planes.emplace_back(borderNormal, -Vector3::Dot(borderNormal, p[corner]));
+						const Quadric borderQuadric{ Quadric::FromPlane(borderNormal, planes.back().w, borderMagnitude * borderMagnitude) };
+						quadrics[ids[corner]] += borderQuadric;
+						quadrics[ids[next]] += borderQuadric;
+						planeIds[ids[corner]].push_back(borderPlaneId);
+						planeIds[ids[next]].push_back(borderPlaneId);
+					}
+				}
+			}
+
+			//Collapses simplified further down to targetNrIndices, stops before a collapse would go over maxError
+			//or when nothing can collapse anymore
+			//The quadric error only orders the collapses, the error that counts is an object space distance: the largest
+			//distance from a kept vertex to the plane of any original triangle it absorbed. Returns the worst one so far
+			float Simplify(size_t targetNrIndices, float maxError)
+			{
+				enum class VertexKind : uint8_t
+				{
+					Manifold,
+					Border,
+					Locked //on an edge with more than two triangles
+				};
+
+				struct Collapse
+				{
+					uint32_t from{};
+					uint32_t to{};
+					double error{};
+				};
+
+				const uint32_t nrVertices{ static_cast<uint32_t>(vertices.size()) };
+				//The quadric error is a weighted mean of squared distances to the same planes, so it never goes over the largest one squared
+				const double maxSquaredError{ static_cast<double>(maxError) * maxError };
+
+				std::unordered_map<uint64_t, uint32_t> edgeCounts{};
+				std::vector<uint32_t> adjacencyOffsets(nrVertices + 1);
+				std::vector<uint32_t> adjacency{};
+				std::vector<VertexKind> vertexKinds(nrVertices);
+				std::vector<Collapse> collapses{};
+				std::vector<uint32_t> remap(nrVertices);
+				std::vector<bool> isTouched(nrVertices);
+				std::vector<std::pair<uint32_t, uint32_t>> wedgeTargets{};
+
+				//Fills wedgeTargets (vertex at from -> vertex at to) and the number of triangles the collapse removes
+				const auto checkCollapse = [&](const Collapse& collapse, uint32_t& nrCollapsedTriangles)
+					{
+						//No triangle that survives may flip
+						bool isValid{ true };
+						nrCollapsedTriangles = 0;
+						for (uint32_t a{ adjacencyOffsets[collapse.from] }; a < adjacencyOffsets[collapse.from + 1] && isValid; ++a)
+						{
+							const uint32_t* pCorners{ &simplified[adjacency[a] * 3] };
+							Vector3 p[3]{};
+							int fromCorner{ -1 };
+							bool hasTo{ false };
+							for (int corner{}; corner < 3; ++corner)
+							{
+								const uint32_t id{ positionIds[pCorners[corner]] };
+								p[corner] = vertices[id].position;
+								if (id == collapse.from)
+									fromCorner = corner;
+								hasTo |= id == collapse.to;
+							}
+							if (hasTo)
+							{
+								++nrCollapsedTriangles;
+								continue;
+							}
+
+							const Vector3 normal{ Vector3::Cross(p[1] - p[0], p[2] - p[0]) };
+							p[fromCorner] = vertices[collapse.to].position;
+							isValid = Vector3::Dot(normal, Vector3::Cross(p[1] - p[0], p[2] - p[0])) > 0.f;
+						}
+						if (!isValid)
+							return false;
+
+						//Every used vertex at from has to merge into the vertex at to it shares its triangles with, otherwise a seam would tear
+						wedgeTargets.clear();
+						uint32_t wedge{ collapse.from };
+						do
+						{
+							uint32_t target{ UINT32_MAX };
+							bool isUsed{ false };
+							for (uint32_t a{ adjacencyOffsets[collapse.from] }; a < adjacencyOffsets[collapse.from + 1] && isValid; ++a)
+							{
+								const uint32_t* pCorners{ &simplified[adjacency[a] * 3] };
+								if (pCorners[0] != wedge && pCorners[1] != wedge && pCorners[2] != wedge)
+									continue;
+
+								isUsed = true;
+								for (int corner{}; corner < 3; ++corner)
+								{
+									if (positionIds[pCorners[corner]] != collapse.to)
+										continue;
+									isValid = target == UINT32_MAX || target == pCorners[corner];
+									target = pCorners[corner];
+								}
+							}
+							if (isUsed && target == UINT32_MAX)
+								isValid = false;
+							if (target != UINT32_MAX)
+								wedgeTargets.emplace_back(wedge, target);
+
+							wedge = nextWedges[wedge];
+						} while (wedge != collapse.from && isValid);
+						return isValid;
+					};
+
+				//Largest distance from the vertex at to to the planes both ends absorbed so far
+				const auto getCollapseDistance = [&](const Collapse& collapse)
+					{
+						const Vector3& p{ vertices[collapse.to].position };
+						float distance{ distances[collapse.to] };
+						for (uint32_t planeId : planeIds[collapse.from])
+						{
+							const Vector4& plane{ planes[planeId] };
+							distance = std::max(distance, std::abs(plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w));
+						}
+						return distance;
+					};
+
+				while (simplified.size() > targetNrIndices)
+				{
+					const uint32_t nrTriangles{ static_cast<uint32_t>(simplified.size() / 3) };
+
+					//Triangles around every position
+					std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+					for (uint32_t index : simplified)
+					{
+						++adjacencyOffsets[positionIds[index] + 1];
+					}
+					for (uint32_t v{}; v < nrVertices; ++v)
+					{
+						adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+					}
+					adjacency.resize(simplified.size());
+					std::vector<uint32_t> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+					for (size_t i{}; i < simplified.size(); ++i)
+					{
+						adjacency[fillOffsets[positionIds[simplified[i]]]++] = static_cast<uint32_t>(i / 3);
+					}
+
+					CountEdges(simplified, positionIds, edgeCounts);
+					std::fill(vertexKinds.begin(), vertexKinds.end(), VertexKind::Manifold);
+					for (const auto& [edge, count] : edgeCounts)
+					{
+						const VertexKind kind{ count == 1 ? VertexKind::Border : count > 2 ? VertexKind::Locked : VertexKind::Manifold };
+						for (uint32_t v : { static_cast<uint32_t>(edge >> 32), static_cast<uint32_t>(edge) })
+						{
+							vertexKinds[v] = std::max(vertexKinds[v], kind);
+						}
+					}
+
+					//Both directions of every edge that can collapse, cheapest first
+					collapses.clear();
+					for (const auto& [edge, count] : edgeCounts)
+					{
+						const uint32_t a{ static_cast<uint32_t>(edge >> 32) };
+						const uint32_t b{ static_cast<uint32_t>(edge) };
+						for (const auto& [from, to] : { std::pair{ a, b }, std::pair{ b, a } })
+						{
+							if (from == to || vertexKinds[from] == VertexKind::Locked || (vertexKinds[from] == VertexKind::Border && count != 1))
+								continue;
+
+							Quadric quadric{ quadrics[from] };
+							quadric += quadrics[to];
+							const Collapse collapse{ from, to, quadric.Evaluate(vertices[to].position) };
+							if (collapse.error > maxSquaredError)
+								continue;
+
+							uint32_t nrCollapsedTriangles{};
+							if (checkCollapse(collapse, nrCollapsedTriangles))
+								collapses.push_back(collapse);
+						}
+					}
+					if (collapses.empty())
+						break;
+					std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+						{
+							if (a.error != b.error)
+								return a.error < b.error;
+							return a.from != b.from ? a.from < b.from : a.to < b.to;
+						});
+
+					//Every collapse removes about two triangles, don't go past the error the cheapest ones needed would reach
+					const uint32_t nrTrianglesToRemove{ nrTriangles - static_cast<uint32_t>(targetNrIndices / 3) };
+					const double errorLimit{ collapses[std::min<size_t>(nrTrianglesToRemove / 2, collapses.size() - 1)].error };
+
+					//Collapses in one pass don't share any triangles, so the adjacency stays valid for all of them
+					for (uint32_t v{}; v < nrVertices; ++v)
+					{
+						remap[v] = v;
+					}
+					std::fill(isTouched.begin(), isTouched.end(), false);
+					uint32_t nrRemovedTriangles{};
+
+					for (const Collapse& collapse : collapses)
+					{
+						if (nrRemovedTriangles >= nrTrianglesToRemove || collapse.error > errorLimit)
+							break;
+						if (isTouched[collapse.from] || isTouched[collapse.to])
+							continue;
+
+						const float distance{ getCollapseDistance(collapse) };
+						if (distance > maxError)
+							continue;
+
+						uint32_t nrCollapsedTriangles{};
+						if (!checkCollapse(collapse, nrCollapsedTriangles))
+							continue;
+
+						for (const auto& [from, to] : wedgeTargets)
+						{
+							remap[from] = to;
+						}
+						quadrics[collapse.to] += quadrics[collapse.from];
+
+						std::vector<uint32_t>& toPlaneIds{ planeIds[collapse.to] };
+						toPlaneIds.insert(toPlaneIds.end(), planeIds[collapse.from].begin(), planeIds[collapse.from].end());
+						std::sort(toPlaneIds.begin(), toPlaneIds.end());
+						toPlaneIds.erase(std::unique(toPlaneIds.begin(), toPlaneIds.end()), toPlaneIds.end());
+						std::vector<uint32_t>{}.swap(planeIds[collapse.from]);
+						distances[collapse.to] = distance;
+						worstDistance = std::max(worstDistance, distance);
+						nrRemovedTriangles += nrCollapsedTriangles;
+
+						for (uint32_t a{ adjacencyOffsets[collapse.from] }; a < adjacencyOffsets[collapse.from + 1]; ++a)
+						{
+							for (int corner{}; corner < 3; ++corner)
+							{
+								isTouched[positionIds[simplified[adjacency[a] * 3 + corner]]] = true;
+							}
+						}
+					}
+
+					if (nrRemovedTriangles == 0)
+						break;
+
+					//Drop the triangles that lost an edge
+					size_t nrIndices{};
+					for (size_t i{}; i + 2 < simplified.size(); i += 3)
+					{
+						const uint32_t v[3]{ remap[simplified[i]], remap[simplified[i + 1]], remap[simplified[i + 2]] };
+						if (positionIds[v[0]] == positionIds[v[1]] || positionIds[v[1]] == positionIds[v[2]] || positionIds[v[2]] == positionIds[v[0]])
+							continue;
+
+						simplified[nrIndices++] = v[0];
+						simplified[nrIndices++] = v[1];
+						simplified[nrIndices++] = v[2];
+					}
+					simplified.resize(nrIndices);
+				}
+
+				return worstDistance;
+			}
+
+			const std::vector<Vertex>& vertices;
+			std::vector<uint32_t> simplified;
+
+			std::vector<uint32_t> positionIds{};
+			std::vector<uint32_t> nextWedges{};
+			std::vector<Quadric> quadrics{};
+			//Original triangle and border planes (normal, d) and the ones every position absorbed
+			std::vector<Vector4> planes{};
+			std::vector<std::vector<uint32_t>> planeIds{};
+			//Largest distance from every position to its absorbed planes
+			std::vector<float> distances{};
+			float worstDistance{};
+		};
+
+		//Level 0 is the full mesh, every next level continues simplifying the one before down to reduction of its triangles
+		//All levels share vertices, their indices get appended to indices and every level gets its own range of meshlets
+		//The error of a level is the largest object space distance between it and the full mesh, see MeshSimplifier
+		//No level goes over maxRelativeError (of the bounding box diagonal), the chain ends once a level
+		//doesn't get rid of at least a tenth of the triangles of the previous one
+		static void BuildLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<Meshlet>& meshlets, std::vector<MeshLod>& lods,
+			uint32_t maxNrLods = 6, float reduction = 0.5f, float maxRelativeError = 0.02f)
+		{
+			Vector3 minPosition{ FLT_MAX, FLT_MAX, FLT_MAX };
+			Vector3 maxPosition{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			for (const Vertex& vertex : vertices)
+			{
+				for (int axis{}; axis < 3; ++axis)
+				{
+					minPosition[axis] = std::min(minPosition[axis], vertex.position[axis]);
+					maxPosition[axis] = std::max(maxPosition[axis], vertex.position[axis]);
+				}
+			}
+			const float maxError{ vertices.empty() ? 0.f : (maxPosition - minPosition).Magnitude() * maxRelativeError };
+
+			MeshSimplifier simplifier{ vertices, indices };
+			std::vector<uint32_t> lodIndices{ indices };
+			std::vector<Meshlet> lodMeshlets{};
+			float error{};
+
+			indices.clear();
+			meshlets.clear();
+			lods.clear();
+			for (uint32_t lodIdx{}; lodIdx < maxNrLods; ++lodIdx)
+			{
+				if (lodIdx > 0)
+				{
+					const size_t targetNrIndices{ static_cast<size_t>(static_cast<float>(lodIndices.size() / 3) * reduction) * 3 };
+					error = simplifier.Simplify(targetNrIndices, maxError);
+					if (simplifier.simplified.size() * 10 > lodIndices.size() * 9)
+						break;
+
+					lodIndices = simplifier.simplified;
+				}
+
+				BuildMeshlets(vertices, lodIndices, lodMeshlets);
+
+				const uint32_t firstIndex{ static_cast<uint32_t>(indices.size()) };
+				lods.push_back(MeshLod{ static_cast<uint32_t>(meshlets.size()), static_cast<uint32_t>(lodMeshlets.size()), error });
+				for (Meshlet& meshlet : lodMeshlets)
+				{
+					meshlet.firstIndex += firstIndex;
+					meshlets.push_back(meshlet);
+				}
+				indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+			}
+		}
+
+		//Stable least significant digit radix sort of indices by keys[index], 8 bits per pass, scratch is the ping-pong buffer
+		static void RadixSortByKey(std::vector<uint32_t>& indices, const std::vector<uint16_t>& keys, std::vector<uint32_t>& scratch)
+		{
+			constexpr int radixBits{ 8 };
+			constexpr int nrPasses{ 16 / radixBits };
+			constexpr int digitMask{ (1 << radixBits) - 1 };
+
+			scratch.resize(indices.size());
+
+			for (int pass{}; pass < nrPasses; ++pass)
+			{
+				const int shift{ pass * radixBits };
+
+				uint32_t offsets[1 << radixBits]{};
+				for (uint32_t index : indices)
+				{
+					++offsets[(keys[index] >> shift) & digitMask];
+				}
+
+				//Counts to the first position of every digit
+				uint32_t offset{};
+				for (uint32_t& digitOffset : offsets)
+				{
+					const uint32_t count{ digitOffset };
+					digitOffset = offset;
+					offset += count;
+				}
+
+				for (uint32_t index : indices)
+				{
+					scratch[offsets[(keys[index] >> shift) & digitMask]++] = index;
+				}
+				indices.swap(scratch);
+			}
+		}
+
 		float Remap(float depthValue, float min, float max)
 		{
 			const float clamped{ std::clamp(depthValue, min, max) };
@@ -0,0 +1,143 @@
+#include "VertexKernels.h"
+
+#include <algorithm>
+#include <immintrin.h>
+
+//Only SSE2, which every x64 CPU has, so there is no need for runtime dispatch here
+
+namespace dae
+{
+	void BuildVertexStreams(const std::vector<Vertex>& vertices, VertexStreams& streams)
+	{
+		const size_t paddedCount{ (vertices.size() + VERTEX_BATCH_SIZE - 1) / VERTEX_BATCH_SIZE * VERTEX_BATCH_SIZE };
+
+		streams.count = vertices.size();
+		for (std::vector<float>* pStream : { &streams.positionX, &streams.positionY, &streams.positionZ, &streams.normalX, &streams.normalY, &streams.normalZ })
+		{
+			pStream->assign(paddedCount, 0.f);
+		}
+		streams.color.resize(vertices.size());
+		streams.uv.resize(vertices.size());
+		streams.tangent.resize(vertices.size());
+
+		for (size_t i{}; i < vertices.size(); ++i)
+		{
+			const Vertex& vertex{ vertices[i] };
+			streams.positionX[i] = vertex.position.x;
+			streams.positionY[i] = vertex.position.y;
+			streams.positionZ[i] = vertex.position.z;
+			streams.normalX[i] = vertex.normal.x;
+			streams.normalY[i] = vertex.normal.y;
+			streams.normalZ[i] = vertex.normal.z;
+			streams.color[i] = vertex.color;
+			streams.uv[i] = vertex.uv;
+			streams.tangent[i] = vertex.tangent;
+		}
+	}
+
+	//Matrix column broadcast to all lanes, rows[i] = data[i][column]
+	struct MatrixColumn
+	{
+		__m128 rows[4];
+	};
+
+	static MatrixColumn BroadcastColumn(const Matrix& matrix, int column)
+	{
+		MatrixColumn result{};
+		for (int row{}; row < 4; ++row)
+		{
+			result.rows[row] = _mm_set1_ps(matrix[row][column]);
+		}
+		return result;
+	}
+
+	//Same operation order as Matrix::TransformPoint
+	static __m128 TransformPointComponent(const MatrixColumn& column, __m128 x, __m128 y, __m128 z)
+	{
+		return _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(column.rows[0], x), _mm_mul_ps(column.rows[1], y)), _mm_mul_ps(column.rows[2], z)), column.rows[3]);
+	}
+
+	//Same operation order as Matrix::TransformVector
+	static __m128 TransformVectorComponent(const MatrixColumn& column, __m128 x, __m128 y, __m128 z)
+	{
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(column.rows[0], x), _mm_mul_ps(column.rows[1], y)), _mm_mul_ps(column.rows[2], z));
+	}
+
+	//Same as Vector3::Normalized, a real division instead of a reciprocal estimate
+	static void Normalize(__m128& x, __m128& y, __m128& z)
+	{
+		const __m128 magnitude{ _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z))) };
+		x = _mm_div_ps(x, magnitude);
+		y = _mm_div_ps(y, magnitude);
+		z = _mm_div_ps(z, magnitude);
+	}
+
+	void TransformVertexStreams(const VertexStreams& streams, const Matrix& worldViewProjectionMatrix, const Matrix& worldMatrix, std::vector<Vertex_Out>& verticesOut,
+		std::vector<Vector4>& clipPositionsOut)
+	{
+		verticesOut.resize(streams.count);
+		clipPositionsOut.resize(streams.count);
+
+		const MatrixColumn positionColumns[4]{ BroadcastColumn(worldViewProjectionMatrix, 0), BroadcastColumn(worldViewProjectionMatrix, 1),
+			BroadcastColumn(worldViewProjectionMatrix, 2), BroadcastColumn(worldViewProjectionMatrix, 3) };
+		const MatrixColumn normalColumns[3]{ BroadcastColumn(worldMatrix, 0), BroadcastColumn(worldMatrix, 1), BroadcastColumn(worldMatrix, 2) };
+
+		alignas(16) float clipPosition[3][VERTEX_BATCH_SIZE]{};
+		alignas(16) float position[4][VERTEX_BATCH_SIZE]{};
+		alignas(16) float normal[3][VERTEX_BATCH_SIZE]{};
+		alignas(16) float viewDirection[3][VERTEX_BATCH_SIZE]{};
+
+		for (size_t first{}; first < streams.count; first += VERTEX_BATCH_SIZE)
+		{
+			const __m128 x{ _mm_loadu_ps(streams.positionX.data() + first) };
+			const __m128 y{ _mm_loadu_ps(streams.positionY.data() + first) };
+			const __m128 z{ _mm_loadu_ps(streams.positionZ.data() + first) };
+
+			//Clip space, then the perspective divide (w stays)
+			const __m128 clipX{ TransformPointComponent(positionColumns[0], x, y, z) };
+			const __m128 clipY{ TransformPointComponent(positionColumns[1], x, y, z) };
+			const __m128 clipZ{ TransformPointComponent(positionColumns[2], x, y, z) };
+			const __m128 w{ TransformPointComponent(positionColumns[3], x, y, z) };
+			_mm_store_ps(clipPosition[0], clipX);
+			_mm_store_ps(clipPosition[1], clipY);
+			_mm_store_ps(clipPosition[2], clipZ);
+			__m128 ndcX{ _mm_div_ps(clipX, w) };
+			__m128 ndcY{ _mm_div_ps(clipY, w) };
+			__m128 ndcZ{ _mm_div_ps(clipZ, w) };
+			_mm_store_ps(position[0], ndcX);
+			_mm_store_ps(position[1], ndcY);
+			_mm_store_ps(position[2], ndcZ);
+			_mm_store_ps(position[3], w);
+
+			const __m128 normalX{ _mm_loadu_ps(streams.normalX.data() + first) };
+			const __m128 normalY{ _mm_loadu_ps(streams.normalY.data() + first) };
+			const __m128 normalZ{ _mm_loadu_ps(streams.normalZ.data() + first) };
+			__m128 worldNormalX{ TransformVectorComponent(normalColumns[0], normalX, normalY, normalZ) };
+			__m128 worldNormalY{ TransformVectorComponent(normalColumns[1], normalX, normalY, normalZ) };
+			__m128 worldNormalZ{ TransformVectorComponent(normalColumns[2], normalX, normalY, normalZ) };
+			Normalize(worldNormalX, worldNormalY, worldNormalZ);
+			_mm_store_ps(normal[0], worldNormalX);
+			_mm_store_ps(normal[1], worldNormalY);
+			_mm_store_ps(normal[2], worldNormalZ);
+
+			Normalize(ndcX, ndcY, ndcZ);
+			_mm_store_ps(viewDirection[0], ndcX);
+			_mm_store_ps(viewDirection[1], ndcY);
+			_mm_store_ps(viewDirection[2], ndcZ);
+
+			//Padding lanes don't get written
+			const size_t count{ std::min<size_t>(VERTEX_BATCH_SIZE, streams.count - first) };
+			for (size_t lane{}; lane < count; ++lane)
+			{
+				clipPositionsOut[first + lane] = Vector4{ clipPosition[0][lane], clipPosition[1][lane], clipPosition[2][lane], position[3][lane] };
+				Vertex_Out& vertexOut{ verticesOut[first + lane] };
+				vertexOut.position = Vector4{ position[0][lane], position[1][lane], position[2][lane], position[3][lane] };
+				vertexOut.color = streams.color[first + lane];
+				vertexOut.uv = streams.uv[first + lane];
+				vertexOut.normal = Vector3{ normal[0][lane], normal[1][lane], normal[2][lane] };
+				vertexOut.tangent = streams.tangent[first + lane];
+				vertexOut.viewDirection = Vector3{ viewDirection[0][lane], viewDirection[1][lane], viewDirection[2][lane] };
+			}
+		}
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <vector>
+#include "DataTypes.h"
+
+namespace dae
+{
+	//Number of vertices one iteration of the SIMD transform handles
+	constexpr int VERTEX_BATCH_SIZE{ 4 };
+
+	//Fills the structure of arrays copy of vertices, every stream gets padded to a multiple of VERTEX_BATCH_SIZE
+	void BuildVertexStreams(const std::vector<Vertex>& vertices, VertexStreams& streams);
+
+	//Same result as the scalar VertexTransformationFunction (bit for bit, no FMA), VERTEX_BATCH_SIZE vertices at a time:
+	//world view projection, perspective divide, world space normal and the view direction
+	//verticesOut and clipPositionsOut (the positions before the divide) get resized to streams.count
+	void TransformVertexStreams(const VertexStreams& streams, const Matrix& worldViewProjectionMatrix, const Matrix& worldMatrix, std::vector<Vertex_Out>& verticesOut,
+		std::vector<Vector4>& clipPositionsOut);
+}
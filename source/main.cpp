@@ -63,10 +63,38 @@ int main(int argc, char* args[])
 			case SDL_KEYUP:
 				if (e.key.keysym.scancode == SDL_SCANCODE_X)
 					takeScreenshot = true;
+				if (e.key.keysym.scancode == SDL_SCANCODE_N)
+					pRenderer->ToggleNormalMap();
+				if (e.key.keysym.scancode == SDL_SCANCODE_P)
+					pRenderer->TogglePacketShading();
+				if (e.key.keysym.scancode == SDL_SCANCODE_G)
+					pRenderer->ToggleSpecularTable();
+				if (e.key.keysym.scancode == SDL_SCANCODE_O)
+					pRenderer->ToggleDepthSorting();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F1)
+					pRenderer->ToggleOcclusionCulling();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F2)
+					pRenderer->ToggleLodSelection();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F3)
+					pRenderer->ToggleMeshletCulling();
 				if (e.key.keysym.scancode == SDL_SCANCODE_F4)
 					pRenderer->SwitchRenderMode();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F5)
+					pRenderer->ToggleLazyVertexTransform();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F6)
+					pRenderer->SwitchVertexLayout();
 				if (e.key.keysym.scancode == SDL_SCANCODE_F7)
 					pRenderer->SwitchColorMode();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F8)
+					pRenderer->ToggleTiledRendering();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F9)
+					pRenderer->SwitchSimdLevel();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F10)
+					pRenderer->SwitchPipelineMode();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F11)
+					pRenderer->SwitchCullMode();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F12)
+					pRenderer->SwitchBufferLayout();
 
 				break;
 			}
@@ -0,0 +1,26 @@
+#pragma once
+#include <iostream>
+
+//Minimal check runner: a failing CHECK prints where it failed and gets counted, the checks keep going
+namespace dae::checks
+{
+	inline int g_NrFailures{};
+
+	inline void Check(bool condition, const char* pExpression, const char* pFile, int line)
+	{
+		if (condition)
+			return;
+
+		std::cerr << pFile << "(" << line << "): CHECK failed: " << pExpression << std::endl;
+		++g_NrFailures;
+	}
+
+	//One per area, see main.cpp
+	void RunRasterCoreChecks();
+	void RunUtilsChecks();
+	void RunCullingChecks();
+	void RunShadeKernelsChecks();
+	void RunGBufferChecks();
+}
+
+#define CHECK(condition) dae::checks::Check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
@@ -0,0 +1,240 @@
+#include "Checks.h"
+
+#include <algorithm>
+#include <vector>
+#include "Culling.h"
+#include "Scene.h"
+
+using namespace dae;
+
+//Camera at the origin looking down +z with a 90 degree field of view, near plane 1 and far plane 100
+static Matrix CreateViewProjection()
+{
+	return Matrix::CreatePerspectiveFovLH(1.f, 1.f, 1.f, 100.f);
+}
+
+static bool IsInside(const BoundingBox& box, const Vector3& point, float tolerance = 1e-4f)
+{
+	for (int axis{}; axis < 3; ++axis)
+	{
+		if (point[axis] < box.min[axis] - tolerance || point[axis] > box.max[axis] + tolerance)
+			return false;
+	}
+	return true;
+}
+
+static void CheckBoundingBox()
+{
+	BoundingBox box{};
+	CHECK(box.min.x > box.max.x);
+	box.Grow(Vector3{ -1.f, 0.f, 2.f });
+	box.Grow(Vector3{ 3.f, -2.f, 1.f });
+	CHECK(box.min.x == -1.f && box.min.y == -2.f && box.min.z == 1.f);
+	CHECK(box.max.x == 3.f && box.max.y == 0.f && box.max.z == 2.f);
+
+	//Holds every transformed corner, and for a quarter turn it is exactly the box around them
+	const Matrix matrices[]{ Matrix::CreateRotationZ(static_cast<float>(M_PI) * 0.5f) * Matrix::CreateTranslation(5.f, 0.f, 0.f),
+		Matrix::CreateScale(2.f, -1.f, 0.5f) * Matrix::CreateRotation(0.3f, 1.1f, -0.7f) * Matrix::CreateTranslation(-2.f, 4.f, 8.f) };
+	for (size_t i{}; i < std::size(matrices); ++i)
+	{
+		const Matrix& matrix{ matrices[i] };
+		const BoundingBox transformed{ box.Transformed(matrix) };
+		BoundingBox corners{};
+		for (int corner{}; corner < 8; ++corner)
+		{
+			const Vector3 point{ matrix.TransformPoint(Vector3{ corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y, corner & 4 ? box.max.z : box.min.z }) };
+			CHECK(IsInside(transformed, point));
+			corners.Grow(point);
+		}
+		if (i == 0)
+			CHECK(IsInside(corners, transformed.min) && IsInside(corners, transformed.max));
+	}
+}
+
+static void CheckFrustum()
+{
+	const Frustum frustum{ Frustum::FromMatrix(CreateViewProjection()) };
+
+	CHECK(!frustum.IsSphereOutside(Vector3{ 0.f, 0.f, 10.f }, 0.1f));
+	CHECK(frustum.IsSphereOutside(Vector3{ 0.f, 0.f, -5.f }, 1.f));
+	CHECK(frustum.IsSphereOutside(Vector3{ 0.f, 0.f, 150.f }, 1.f));
+	//Centre outside the left plane (x = -z), distance to it is 6 / sqrt(2)
+	CHECK(frustum.IsSphereOutside(Vector3{ -16.f, 0.f, 10.f }, 4.f));
+	CHECK(!frustum.IsSphereOutside(Vector3{ -16.f, 0.f, 10.f }, 4.5f));
+
+	BoundingBox box{};
+	box.Grow(Vector3{ -1.f, -1.f, 9.f });
+	box.Grow(Vector3{ 1.f, 1.f, 11.f });
+	CHECK(!frustum.IsBoxOutside(box));
+	CHECK(frustum.IsBoxOutside(box.Transformed(Matrix::CreateTranslation(0.f, 20.f, 0.f))));
+	CHECK(frustum.IsBoxOutside(box.Transformed(Matrix::CreateTranslation(0.f, 0.f, -12.f))));
+	//Straddling the top plane
+	CHECK(!frustum.IsBoxOutside(box.Transformed(Matrix::CreateTranslation(0.f, 10.5f, 0.f))));
+}
+
+static std::vector<uint32_t> QueryBruteForce(const Scene& scene, const Frustum& frustum)
+{
+	std::vector<uint32_t> instanceIndices{};
+	for (uint32_t instanceIdx{}; instanceIdx < scene.GetNrInstances(); ++instanceIdx)
+	{
+		const MeshInstance& instance{ scene.GetInstance(instanceIdx) };
+		if (!frustum.IsBoxOutside(scene.GetMeshBounds(instance.meshIdx).Transformed(instance.worldMatrix)))
+			instanceIndices.push_back(instanceIdx);
+	}
+	return instanceIndices;
+}
+
+static std::vector<uint32_t> QueryScene(const Scene& scene, const Frustum& frustum)
+{
+	std::vector<uint32_t> instanceIndices{};
+	scene.QueryFrustum(frustum, instanceIndices);
+	std::sort(instanceIndices.begin(), instanceIndices.end());
+	return instanceIndices;
+}
+
+//The BVH has to find exactly the instances a test of every instance finds, after a rebuild and after refits
+static void CheckSceneBVH()
+{
+	Mesh mesh{};
+	for (int corner{}; corner < 8; ++corner)
+	{
+		Vertex vertex{};
+		vertex.position = Vector3{ corner & 1 ? 0.5f : -0.5f, corner & 2 ? 0.5f : -0.5f, corner & 4 ? 0.5f : -0.5f };
+		mesh.vertices.push_back(vertex);
+	}
+
+	Scene scene{};
+	const uint32_t meshIdx{ scene.AddMesh(std::move(mesh)) };
+	std::vector<Matrix> worldMatrices{};
+	for (int z{}; z < 8; ++z)
+	{
+		for (int x{}; x < 8; ++x)
+		{
+			worldMatrices.push_back(Matrix::CreateTranslation((x - 3.5f) * 6.f, 0.f, z * 6.f + 2.f));
+		}
+	}
+	CHECK(scene.AddInstances(meshIdx, worldMatrices) == 0);
+	CHECK(scene.GetNrInstances() == worldMatrices.size());
+	scene.UpdateBVH();
+
+	const Frustum frustum{ Frustum::FromMatrix(CreateViewProjection()) };
+	const std::vector<uint32_t> visible{ QueryScene(scene, frustum) };
+	CHECK(visible == QueryBruteForce(scene, frustum));
+	CHECK(!visible.empty() && visible.size() < worldMatrices.size());
+
+	//Pull some instances out of view and push others in, a few frames in a row
+	for (int frame{}; frame < 3; ++frame)
+	{
+		for (uint32_t instanceIdx{ static_cast<uint32_t>(frame) }; instanceIdx < scene.GetNrInstances(); instanceIdx += 5)
+		{
+			const Vector3 offset{ frame % 2 == 0 ? Vector3{ 0.f, 0.f, -40.f } : Vector3{ 0.f, 0.f, 30.f } };
+			scene.SetWorldMatrix(instanceIdx, scene.GetInstance(instanceIdx).worldMatrix * Matrix::CreateTranslation(offset));
+		}
+		scene.UpdateBVH();
+		CHECK(QueryScene(scene, frustum) == QueryBruteForce(scene, frustum));
+	}
+}
+
+static void CheckDepthPyramidLevels()
+{
+	//Odd sizes on purpose, the last column and row of a level have fewer texels under them
+	constexpr int nrBlocksX{ 7 };
+	constexpr int nrBlocksY{ 5 };
+	std::vector<float> blockMaxDepths(nrBlocksX * nrBlocksY);
+	DepthPyramid pyramid{};
+	const float* pFirstLevel{};
+	for (int frame{}; frame < 2; ++frame)
+	{
+		for (size_t i{}; i < blockMaxDepths.size(); ++i)
+		{
+			blockMaxDepths[i] = static_cast<float>((i * 37 + frame * 11) % 23) / 23.f;
+		}
+
+		//The second frame reuses the levels of the first
+		pyramid.Build(blockMaxDepths.data(), nrBlocksX, nrBlocksY, 8, nrBlocksX * 8, nrBlocksY * 8, Matrix{});
+		if (frame == 0)
+			pFirstLevel = pyramid.levels[0].maxDepths.data();
+		CHECK(pyramid.levels[0].maxDepths.data() == pFirstLevel);
+		CHECK(pyramid.levels.back().width == 1 && pyramid.levels.back().height == 1);
+
+		//Every texel is the farthest of the blocks under it
+		for (size_t levelIdx{}; levelIdx < pyramid.levels.size(); ++levelIdx)
+		{
+			const DepthPyramid::Level& level{ pyramid.levels[levelIdx] };
+			for (int y{}; y < level.height; ++y)
+			{
+				for (int x{}; x < level.width; ++x)
+				{
+					float maxDepth{ -FLT_MAX };
+					for (int blockY{ y << levelIdx }; blockY < std::min((y + 1) << levelIdx, nrBlocksY); ++blockY)
+					{
+						for (int blockX{ x << levelIdx }; blockX < std::min((x + 1) << levelIdx, nrBlocksX); ++blockX)
+						{
+							maxDepth = std::max(maxDepth, blockMaxDepths[blockX + blockY * nrBlocksX]);
+						}
+					}
+					CHECK(level.maxDepths[x + y * level.width] == maxDepth);
+				}
+			}
+		}
+	}
+}
+
+//Depth buffer value at view depth z, for CreateViewProjection
+static float GetDepth(float z)
+{
+	return 100.f / 99.f * (1.f - 1.f / z);
+}
+
+static void CheckDepthPyramidOcclusion()
+{
+	constexpr int blockSize{ 8 };
+	constexpr int nrBlocksX{ 10 };
+	constexpr int nrBlocksY{ 6 };
+	const Matrix viewProjection{ Matrix::CreatePerspectiveFovLH(1.f, static_cast<float>(nrBlocksX) / nrBlocksY, 1.f, 100.f) };
+
+	//A wall at z = 4 with a hole of one block
+	std::vector<float> blockMaxDepths(nrBlocksX * nrBlocksY, GetDepth(4.f));
+	constexpr int holeX{ 2 }, holeY{ 1 };
+	blockMaxDepths[holeX + holeY * nrBlocksX] = FLT_MAX;
+
+	DepthPyramid pyramid{};
+	CHECK(!pyramid.IsBoxOccluded(viewProjection, Vector3{ -1.f, -1.f, 10.f }, Vector3{ 1.f, 1.f, 12.f }));
+	pyramid.Build(blockMaxDepths.data(), nrBlocksX, nrBlocksY, blockSize, nrBlocksX * blockSize, nrBlocksY * blockSize, viewProjection);
+
+	CHECK(pyramid.IsBoxOccluded(viewProjection, Vector3{ -1.f, -1.f, 10.f }, Vector3{ 1.f, 1.f, 12.f }));
+	//In front of the wall, reaching through it, behind the camera and past the screen edge
+	CHECK(!pyramid.IsBoxOccluded(viewProjection, Vector3{ -0.5f, -0.5f, 2.f }, Vector3{ 0.5f, 0.5f, 3.f }));
+	CHECK(!pyramid.IsBoxOccluded(viewProjection, Vector3{ -0.5f, -0.5f, 3.f }, Vector3{ 0.5f, 0.5f, 12.f }));
+	CHECK(!pyramid.IsBoxOccluded(viewProjection, Vector3{ -0.5f, -0.5f, -1.f }, Vector3{ 0.5f, 0.5f, 12.f }));
+	CHECK(!pyramid.IsBoxOccluded(viewProjection, Vector3{ 20.f, -0.5f, 10.f }, Vector3{ 40.f, 0.5f, 12.f }));
+
+	//Boxes all over the screen behind the wall: only occluded when none of the pixels they cover is the hole
+	const float aspect{ static_cast<float>(nrBlocksX) / nrBlocksY };
+	for (int y{}; y < 12; ++y)
+	{
+		for (int x{}; x < 20; ++x)
+		{
+			//Centre in NDC, the box is 0.1 wide at z = 10 (0.01 in NDC)
+			const float ndcX{ (x + 0.5f) / 10.f - 1.f };
+			const float ndcY{ 1.f - (y + 0.5f) / 6.f };
+			const Vector3 center{ ndcX * aspect * 10.f, ndcY * 10.f, 10.f };
+			const Vector3 extent{ 0.05f, 0.05f, 0.05f };
+			const bool isOccluded{ pyramid.IsBoxOccluded(viewProjection, center - extent, center + extent) };
+
+			const int pixelX{ static_cast<int>((ndcX + 1.f) * 0.5f * nrBlocksX * blockSize) };
+			const int pixelY{ static_cast<int>((1.f - ndcY) * 0.5f * nrBlocksY * blockSize) };
+			const bool isInHole{ pixelX / blockSize == holeX && pixelY / blockSize == holeY };
+			CHECK(isOccluded == !isInHole);
+		}
+	}
+}
+
+void checks::RunCullingChecks()
+{
+	CheckBoundingBox();
+	CheckFrustum();
+	CheckSceneBVH();
+	CheckDepthPyramidLevels();
+	CheckDepthPyramidOcclusion();
+}
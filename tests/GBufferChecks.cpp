@@ -0,0 +1,57 @@
+#include "Checks.h"
+
+#include <cmath>
+#include "GBuffer.h"
+
+using namespace dae;
+
+static void CheckOctahedral()
+{
+	//The axes, including the corners of the fold
+	const Vector3 axes[]{ Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, -Vector3::UnitX, -Vector3::UnitY, -Vector3::UnitZ };
+	for (const Vector3& axis : axes)
+	{
+		CHECK((DecodeOctahedral(EncodeOctahedral(axis)) - axis).Magnitude() < 1e-4f);
+	}
+
+	//Directions all over the sphere (both halves and the fold) come back normalized and within 2 x 16 bits of precision
+	float maxError{};
+	for (int i{}; i < 64; ++i)
+	{
+		for (int j{}; j <= 32; ++j)
+		{
+			const float azimuth{ 2.f * static_cast<float>(M_PI) * i / 64.f };
+			const float polar{ static_cast<float>(M_PI) * j / 32.f };
+			const Vector3 normal{ sinf(polar) * cosf(azimuth), sinf(polar) * sinf(azimuth), cosf(polar) };
+			const Vector3 decoded{ DecodeOctahedral(EncodeOctahedral(normal)) };
+			CHECK(std::abs(decoded.Magnitude() - 1.f) < 1e-6f);
+			maxError = std::max(maxError, (decoded - normal).Magnitude());
+		}
+	}
+	CHECK(maxError < 1e-4f);
+}
+
+static void CheckUnorm8()
+{
+	//Every 8 bit value survives the round trip exactly, w goes in the top byte
+	for (uint32_t value{}; value < 256; ++value)
+	{
+		const float f{ value / 255.f };
+		const uint32_t packed{ PackUnorm8(ColorRGB{ f, 1.f - f, f }, f) };
+		CHECK(packed == (value | (255 - value) << 8 | value << 16 | value << 24));
+
+		const ColorRGB color{ UnpackUnorm8(packed) };
+		CHECK(color.r == f && color.b == f);
+		CHECK(UnpackUnorm8W(packed) == f);
+	}
+
+	//Rounds to the nearest step and clamps to [0, 1]
+	CHECK(PackUnorm8(ColorRGB{ 0.5f / 255.f + 1e-4f, 1.49f / 255.f, 0.f }) == (1u | 1u << 8));
+	CHECK(PackUnorm8(ColorRGB{ -1.f, 2.f, 0.f }, 7.f) == (0u | 255u << 8 | 0u << 16 | 255u << 24));
+}
+
+void checks::RunGBufferChecks()
+{
+	CheckOctahedral();
+	CheckUnorm8();
+}
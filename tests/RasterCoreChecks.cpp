@@ -0,0 +1,216 @@
+#include "Checks.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+#include "RasterCore.h"
+#include "RasterKernels.h"
+
+using namespace dae;
+
+constexpr int GRID_SIZE{ 16 };
+
+//Adds one to every pixel of the grid whose sample the triangle covers, walking the edge functions like the rasterizer does
+static void AddCoverage(const Vector2& p0, const Vector2& p1, const Vector2& p2, std::vector<int>& coverage)
+{
+	TriangleEdges triangleEdges{};
+	if (!SetupTriangleEdges(p0, p1, p2, 0, 0, GRID_SIZE, GRID_SIZE, triangleEdges))
+		return;
+
+	for (int py{ triangleEdges.minY }; py < triangleEdges.maxY; ++py)
+	{
+		for (int px{ triangleEdges.minX }; px < triangleEdges.maxX; ++px)
+		{
+			bool isCovered{ true };
+			for (const EdgeFunction& edge : triangleEdges.edges)
+			{
+				const int64_t value{ edge.value + edge.stepX * (px - triangleEdges.minX) + edge.stepY * (py - triangleEdges.minY) };
+				isCovered &= value - edge.bias >= 0;
+			}
+			if (isCovered)
+				++coverage[py * GRID_SIZE + px];
+		}
+	}
+}
+
+//Quads with their corners on pixel centres, split in two: samples on the shared edges have to go to exactly one triangle
+static void CheckSharedEdges()
+{
+	std::vector<int> coverage(GRID_SIZE * GRID_SIZE, 0);
+	for (int y{ 2 }; y < 14; y += 3)
+	{
+		for (int x{ 2 }; x < 14; x += 4)
+		{
+			const Vector2 topLeft{ x + 0.5f, y + 0.5f };
+			const Vector2 topRight{ x + 4.5f, y + 0.5f };
+			const Vector2 bottomRight{ x + 4.5f, y + 3.5f };
+			const Vector2 bottomLeft{ x + 0.5f, y + 3.5f };
+			AddCoverage(topLeft, topRight, bottomRight, coverage);
+			AddCoverage(topLeft, bottomRight, bottomLeft, coverage);
+		}
+	}
+
+	//The quads span the sample centres [2.5, 14.5[ on both axes, the right and bottom edges belong to the next pixels
+	for (int py{}; py < GRID_SIZE; ++py)
+	{
+		for (int px{}; px < GRID_SIZE; ++px)
+		{
+			const bool isInside{ px >= 2 && px < 14 && py >= 2 && py < 14 };
+			CHECK(coverage[py * GRID_SIZE + px] == (isInside ? 1 : 0));
+		}
+	}
+}
+
+//Fan around a pixel centre with ring vertices off the pixel grid, no sample may be covered twice
+static void CheckFan()
+{
+	constexpr int nrRingVertices{ 11 };
+	const Vector2 center{ 8.5f, 8.5f };
+	std::vector<Vector2> ring{};
+	for (int i{}; i < nrRingVertices; ++i)
+	{
+		const float angle{ 2.f * static_cast<float>(M_PI) * i / nrRingVertices };
+		ring.push_back(SnapToSubpixel(Vector2{ center.x + 6.3f * cosf(angle), center.y + 6.3f * sinf(angle) }));
+	}
+
+	std::vector<int> coverage(GRID_SIZE * GRID_SIZE, 0);
+	for (int i{}; i < nrRingVertices; ++i)
+	{
+		//Increasing angles go clockwise on screen (y down)
+		const Vector2& p1{ ring[i] };
+		const Vector2& p2{ ring[(i + 1) % nrRingVertices] };
+		CHECK(CalculateSignedArea(center, p1, p2) > 0);
+		AddCoverage(center, p1, p2, coverage);
+	}
+
+	for (int py{}; py < GRID_SIZE; ++py)
+	{
+		for (int px{}; px < GRID_SIZE; ++px)
+		{
+			const float dx{ px + 0.5f - center.x };
+			const float dy{ py + 0.5f - center.y };
+			const int count{ coverage[py * GRID_SIZE + px] };
+			CHECK(count <= 1);
+			//Well inside the polygon, the ring can't be more than 6.3 * (1 - cos(pi / 11)) + a subpixel closer
+			if (dx * dx + dy * dy < 5.5f * 5.5f)
+				CHECK(count == 1);
+		}
+	}
+}
+
+static void CheckFixedPoint()
+{
+	CHECK(ToFixedPoint(1.f) == SUBPIXEL_STEPS);
+	CHECK(ToFixedPoint(-0.5f) == -SUBPIXEL_HALF);
+
+	const Vector2 snapped{ SnapToSubpixel(Vector2{ 1.03f, 2.97f }) };
+	CHECK(snapped.x == 1.f);
+	CHECK(snapped.y == 3.f);
+
+	//Clockwise on screen is positive, the other winding and degenerate triangles don't get set up
+	const Vector2 p0{ 1.5f, 1.5f }, p1{ 5.5f, 1.5f }, p2{ 1.5f, 5.5f };
+	CHECK(CalculateSignedArea(p0, p1, p2) == 4 * SUBPIXEL_STEPS * 4 * SUBPIXEL_STEPS);
+	CHECK(CalculateSignedArea(p0, p2, p1) < 0);
+	TriangleEdges triangleEdges{};
+	CHECK(SetupTriangleEdges(p0, p1, p2, 0, 0, GRID_SIZE, GRID_SIZE, triangleEdges));
+	CHECK(!SetupTriangleEdges(p0, p2, p1, 0, 0, GRID_SIZE, GRID_SIZE, triangleEdges));
+	CHECK(!SetupTriangleEdges(p0, p1, Vector2{ 9.5f, 1.5f }, 0, 0, GRID_SIZE, GRID_SIZE, triangleEdges));
+	//Nothing left after clipping to the rectangle
+	CHECK(!SetupTriangleEdges(p0, p1, p2, 8, 8, GRID_SIZE, GRID_SIZE, triangleEdges));
+
+	CHECK(IsTopLeftEdge(1, 0));
+	CHECK(!IsTopLeftEdge(-1, 0));
+	CHECK(IsTopLeftEdge(0, -1));
+	CHECK(!IsTopLeftEdge(0, 1));
+
+	//Between the sample centres 2.5 and 3.5 on both axes
+	CHECK(IsMicroTriangle(Vector2{ 2.6f, 2.6f }, Vector2{ 3.4f, 2.6f }, Vector2{ 2.6f, 3.4f }));
+	CHECK(!IsMicroTriangle(Vector2{ 2.4f, 2.4f }, Vector2{ 3.4f, 2.6f }, Vector2{ 2.6f, 3.4f }));
+}
+
+//Span of count pixels from (px, py), edge values taken like the rasterizer steps them
+static SpanEdges GetSpanEdges(const TriangleEdges& triangleEdges, int px, int py)
+{
+	SpanEdges spanEdges{};
+	for (int i{}; i < 3; ++i)
+	{
+		const EdgeFunction& edge{ triangleEdges.edges[i] };
+		spanEdges.value[i] = edge.value + edge.stepX * (px - triangleEdges.minX) + edge.stepY * (py - triangleEdges.minY);
+		spanEdges.stepX[i] = edge.stepX;
+		spanEdges.bias[i] = edge.bias;
+	}
+	return spanEdges;
+}
+
+//The SSE4 and AVX2 span kernels have to give the scalar reference's coverage, weights and depths exactly
+static void CheckSpanKernels()
+{
+	const SimdLevel maxSimdLevel{ DetectSimdLevel() };
+	const Vector2 triangles[][3]{
+		{ { 0.5f, 0.5f }, { 15.3f, 2.7f }, { 3.1f, 14.9f } },
+		{ { 2.5f, 2.5f }, { 14.5f, 2.5f }, { 14.5f, 14.5f } },
+		{ { 7.1f, 1.2f }, { 8.3f, 15.8f }, { 6.9f, 15.1f } } };
+	const float invDepth[3]{ 1.f / 0.5f, 1.f / 0.9f, 1.f / 0.7f };
+
+	for (const SimdLevel simdLevel : { SimdLevel::SSE4, SimdLevel::AVX2 })
+	{
+		if (simdLevel > maxSimdLevel)
+			continue;
+
+		const RasterizeSpanFunction pRasterizeLess{ GetRasterizeSpanFunction(simdLevel, DepthTest::Less) };
+		const RasterizeSpanFunction pRasterizeEqual{ GetRasterizeSpanFunction(simdLevel, DepthTest::Equal) };
+		for (const auto& triangle : triangles)
+		{
+			TriangleEdges triangleEdges{};
+			if (!SetupTriangleEdges(triangle[0], triangle[1], triangle[2], 0, 0, GRID_SIZE, GRID_SIZE, triangleEdges))
+				continue;
+
+			for (int py{ triangleEdges.minY }; py < triangleEdges.maxY; ++py)
+			{
+				for (int px{ triangleEdges.minX }; px < triangleEdges.maxX; px += SPAN_WIDTH)
+				{
+					const SpanEdges spanEdges{ GetSpanEdges(triangleEdges, px, py) };
+					CHECK(FitsSimdRange(spanEdges));
+					const int count{ std::min(SPAN_WIDTH, triangleEdges.maxX - px) };
+
+					//Some lanes already hold something closer
+					float referenceDepths[SPAN_WIDTH];
+					for (int i{}; i < SPAN_WIDTH; ++i)
+					{
+						referenceDepths[i] = (px + py + i) % 3 == 0 ? 0.6f : FLT_MAX;
+					}
+					float depths[SPAN_WIDTH];
+					std::copy(referenceDepths, referenceDepths + SPAN_WIDTH, depths);
+
+					PixelSpan reference{};
+					PixelSpan span{};
+					const uint32_t referenceMask{ RasterizeSpanScalar<DepthTest::Less>(spanEdges, invDepth, triangleEdges.invArea, count, referenceDepths, reference) };
+					const uint32_t mask{ pRasterizeLess(spanEdges, invDepth, triangleEdges.invArea, count, depths, span) };
+					CHECK(mask == referenceMask);
+					for (int i{}; i < SPAN_WIDTH; ++i)
+					{
+						CHECK(depths[i] == referenceDepths[i]);
+						if (!(referenceMask & 1u << i))
+							continue;
+
+						CHECK(span.weight0[i] == reference.weight0[i]);
+						CHECK(span.weight1[i] == reference.weight1[i]);
+						CHECK(span.weight2[i] == reference.weight2[i]);
+						CHECK(span.depth[i] == reference.depth[i]);
+					}
+
+					//Second pass of a depth pre-pass: exactly the lanes that wrote their depth pass again
+					CHECK(pRasterizeEqual(spanEdges, invDepth, triangleEdges.invArea, count, depths, span) == referenceMask);
+				}
+			}
+		}
+	}
+}
+
+void checks::RunRasterCoreChecks()
+{
+	CheckFixedPoint();
+	CheckSharedEdges();
+	CheckFan();
+	CheckSpanKernels();
+}
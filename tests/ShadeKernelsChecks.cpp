@@ -0,0 +1,125 @@
+#include "Checks.h"
+
+#include <cmath>
+#include <span>
+#include "ShadeKernels.h"
+
+using namespace dae;
+
+constexpr float GLOSSINESS{ 25.f };
+
+//Runs the specular packet kernel with one light straight down on an upward normal, so every lane's color is exactly
+//the specular power of its cosine (the view direction's angle with the reflected light) and gloss
+static void ShadeSpecularPowers(ShadePacketFunction pShadePacket, const SpecularPowerTable* pTable, const float cosines[SPAN_WIDTH], float gloss,
+	float powers[SPAN_WIDTH])
+{
+	const Light light{ Light::CreateDirectional(Vector3{ 0.f, 0.f, -1.f }, 1.f) };
+	ShadeConstants constants{};
+	constants.pLights = &light;
+	constants.glossiness = GLOSSINESS;
+	constants.pSpecularTable = pTable;
+
+	ShadePacket packet{};
+	for (int i{}; i < SPAN_WIDTH; ++i)
+	{
+		packet.normal[2][i] = 1.f;
+		packet.viewDirection[0][i] = sqrtf(std::max(1.f - cosines[i] * cosines[i], 0.f));
+		packet.viewDirection[2][i] = -cosines[i];
+		for (int channel{}; channel < 3; ++channel)
+		{
+			packet.specular[channel][i] = 1.f;
+		}
+		packet.gloss[i] = gloss;
+	}
+
+	const uint32_t lightIdx{ 0 };
+	const float depths[SPAN_WIDTH]{};
+	pShadePacket(constants, std::span<const uint32_t>{ &lightIdx, 1 }, 0, 0, depths, packet);
+	for (int i{}; i < SPAN_WIDTH; ++i)
+	{
+		powers[i] = packet.color[0][i];
+	}
+}
+
+//The polynomial exp2(exponent * log2(cosine)) of the packets against powf
+static void CheckPacketPow()
+{
+	const ShadePacketFunction pShadePacket{ GetShadePacketFunction(DetectSimdLevel(), ColorMode::Specular, false) };
+	if (!pShadePacket)
+		return;
+
+	const float cosineSets[][SPAN_WIDTH]{
+		{ 0.f, 1e-6f, 1e-3f, 0.01f, 0.1f, 0.25f, 0.5f, 1.f },
+		{ 0.6f, 0.7f, 0.75f, 0.8f, 0.9f, 0.95f, 0.99f, 0.99999f } };
+	for (const float (&cosines)[SPAN_WIDTH] : cosineSets)
+	{
+		for (const float gloss : { 0.f, 1.f / 255.f, 0.02f, 0.1f, 0.37f, 0.5f, 1.f })
+		{
+			float powers[SPAN_WIDTH];
+			ShadeSpecularPowers(pShadePacket, nullptr, cosines, gloss, powers);
+			for (int i{}; i < SPAN_WIDTH; ++i)
+			{
+				//Within a relative 2e-6 from 1 / 255 up, below that the absolute error can't show in 8 bits
+				const float expected{ powf(cosines[i], gloss * GLOSSINESS) };
+				const float tolerance{ expected > 1.f / 255.f ? expected * 2e-6f : 1e-6f };
+				CHECK(std::abs(powers[i] - expected) <= tolerance);
+			}
+		}
+	}
+}
+
+static void CheckSpecularPowerTable()
+{
+	SpecularPowerTable table{};
+	table.Build(GLOSSINESS);
+	CHECK(table.glossiness == GLOSSINESS);
+	//Exponent 10 / 255 * 25 is still below 1, 11 / 255 * 25 isn't
+	CHECK(table.firstRow == 11);
+
+	//Within 5e-4 of powf for exponents up to 32, the rows below the table and cosines of 1 and up are powf exactly
+	for (int row{}; row < SpecularPowerTable::NR_GLOSS_ROWS; ++row)
+	{
+		const float gloss{ row / 255.f };
+		CHECK(SpecularPowerTable::GetRow(gloss) == row);
+		for (int i{}; i <= 1000; ++i)
+		{
+			const float cosine{ i / 1000.f };
+			const float expected{ powf(cosine, gloss * GLOSSINESS) };
+			const float lookup{ table.Lookup(cosine, gloss) };
+			if (row < table.firstRow || cosine >= 1.f)
+				CHECK(lookup == expected);
+			else
+				CHECK(std::abs(lookup - expected) <= 5e-4f);
+		}
+		CHECK(table.Lookup(1.5f, gloss) == powf(1.5f, gloss * GLOSSINESS));
+	}
+
+	const SimdLevel simdLevel{ DetectSimdLevel() };
+	CHECK(MatchesScalarSpecularLookup(simdLevel, table));
+
+	//The packets look up the same values as the scalar path, whatever falls back goes through the packet pow
+	const ShadePacketFunction pShadePacket{ GetShadePacketFunction(simdLevel, ColorMode::Specular, false) };
+	if (!pShadePacket)
+		return;
+
+	const float cosines[SPAN_WIDTH]{ 0.f, 0.001f, 0.3f, 0.5f, 0.77f, 0.9f, 0.999f, 1.f };
+	for (const int row : { 0, table.firstRow - 1, table.firstRow, 64, 200, SpecularPowerTable::NR_GLOSS_ROWS - 1 })
+	{
+		const float gloss{ row / 255.f };
+		float lookups[SPAN_WIDTH];
+		float powers[SPAN_WIDTH];
+		ShadeSpecularPowers(pShadePacket, &table, cosines, gloss, lookups);
+		ShadeSpecularPowers(pShadePacket, nullptr, cosines, gloss, powers);
+		for (int i{}; i < SPAN_WIDTH; ++i)
+		{
+			const bool isFallback{ row < table.firstRow || !(cosines[i] < 1.f) };
+			CHECK(lookups[i] == (isFallback ? powers[i] : table.Lookup(cosines[i], gloss)));
+		}
+	}
+}
+
+void checks::RunShadeKernelsChecks()
+{
+	CheckPacketPow();
+	CheckSpecularPowerTable();
+}
@@ -0,0 +1,278 @@
+#include "Checks.h"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+#include "Culling.h"
+#include "Utils.h"
+
+using namespace dae;
+
+//size x size quads in the xy plane (z up), with a bump of bumpHeight in the middle and the triangles shuffled
+static void BuildGridMesh(int size, float bumpHeight, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	vertices.clear();
+	indices.clear();
+	for (int y{}; y <= size; ++y)
+	{
+		for (int x{}; x <= size; ++x)
+		{
+			const float dx{ x - size * 0.5f };
+			const float dy{ y - size * 0.5f };
+			Vertex vertex{};
+			vertex.position = Vector3{ static_cast<float>(x), static_cast<float>(y), bumpHeight * expf(-(dx * dx + dy * dy) / (size * 0.5f)) };
+			vertex.normal = Vector3::UnitZ;
+			vertices.push_back(vertex);
+		}
+	}
+
+	//Counter clockwise seen from above
+	for (int y{}; y < size; ++y)
+	{
+		for (int x{}; x < size; ++x)
+		{
+			const uint32_t v0{ static_cast<uint32_t>(y * (size + 1) + x) };
+			const uint32_t v1{ v0 + 1 };
+			const uint32_t v2{ v0 + size + 1 };
+			const uint32_t v3{ v2 + 1 };
+			indices.insert(indices.end(), { v0, v1, v3, v0, v3, v2 });
+		}
+	}
+
+	//Fixed linear congruential shuffle of the triangles, so the input order doesn't suit any cache
+	uint32_t state{ 12345 };
+	for (size_t t{ indices.size() / 3 - 1 }; t > 0; --t)
+	{
+		state = state * 1664525u + 1013904223u;
+		const size_t other{ (state >> 8) % (t + 1) };
+		for (int corner{}; corner < 3; ++corner)
+		{
+			std::swap(indices[t * 3 + corner], indices[other * 3 + corner]);
+		}
+	}
+}
+
+//Every triangle rotated so its smallest index comes first (the winding stays), sorted
+static std::vector<std::array<uint32_t, 3>> GetCanonicalTriangles(const std::vector<uint32_t>& indices)
+{
+	std::vector<std::array<uint32_t, 3>> triangles{};
+	for (size_t i{}; i + 2 < indices.size(); i += 3)
+	{
+		std::array<uint32_t, 3> triangle{ indices[i], indices[i + 1], indices[i + 2] };
+		std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+static void CheckVertexCacheOrder()
+{
+	//A strip of 4 triangles over 6 vertices loads every vertex once, the same triangles again with a cache of 3 reload 2 of them
+	const std::vector<uint32_t> strip{ 0, 1, 2, 1, 3, 2, 2, 3, 4, 3, 5, 4 };
+	CHECK(Utils::CalculateACMR(strip, 6, 16) == 6.f / 4.f);
+	CHECK(Utils::CalculateACMR({ 0, 1, 2, 3, 4, 5, 0, 1, 2 }, 6, 3) == 9.f / 3.f);
+	CHECK(Utils::CalculateACMR({ 0, 1, 2, 3, 4, 5, 0, 1, 2 }, 6, 6) == 6.f / 3.f);
+
+	std::vector<Vertex> vertices{};
+	std::vector<uint32_t> indices{};
+	BuildGridMesh(16, 3.f, vertices, indices);
+	const std::vector<uint32_t> original{ indices };
+	const float acmrBefore{ Utils::CalculateACMR(indices, vertices.size(), Utils::VERTEX_CACHE_SIZE) };
+
+	//Only the order changes, not the triangles or their winding
+	Utils::ReorderTrianglesTipsify(indices, vertices.size(), Utils::VERTEX_CACHE_SIZE);
+	CHECK(GetCanonicalTriangles(indices) == GetCanonicalTriangles(original));
+	const float acmrAfter{ Utils::CalculateACMR(indices, vertices.size(), Utils::VERTEX_CACHE_SIZE) };
+	CHECK(acmrAfter < acmrBefore * 0.75f);
+
+	//Renumbered in order of first use, every corner keeps its position
+	const std::vector<Vertex> originalVertices{ vertices };
+	const std::vector<uint32_t> tipsified{ indices };
+	Utils::ReorderVertices(vertices, indices);
+	CHECK(vertices.size() == originalVertices.size());
+	uint32_t nextNewIndex{};
+	for (size_t i{}; i < indices.size(); ++i)
+	{
+		CHECK((vertices[indices[i]].position - originalVertices[tipsified[i]].position).SqrMagnitude() == 0.f);
+		CHECK(indices[i] <= nextNewIndex);
+		nextNewIndex = std::max(nextNewIndex, indices[i] + 1);
+	}
+}
+
+static void CheckMeshlets()
+{
+	std::vector<Vertex> vertices{};
+	std::vector<uint32_t> indices{};
+	BuildGridMesh(24, 3.f, vertices, indices);
+	const std::vector<uint32_t> original{ indices };
+
+	std::vector<Meshlet> meshlets{};
+	Utils::BuildMeshlets(vertices, indices, meshlets);
+	CHECK(GetCanonicalTriangles(indices) == GetCanonicalTriangles(original));
+
+	//Consecutive ranges over all indices, within the limits
+	uint32_t nextIndex{};
+	for (const Meshlet& meshlet : meshlets)
+	{
+		CHECK(meshlet.firstIndex == nextIndex);
+		CHECK(meshlet.nrIndices > 0 && meshlet.nrIndices % 3 == 0);
+		CHECK(meshlet.nrIndices / 3 <= Utils::MESHLET_MAX_TRIANGLES);
+		nextIndex = meshlet.firstIndex + meshlet.nrIndices;
+
+		std::vector<uint32_t> meshletVertices(indices.begin() + meshlet.firstIndex, indices.begin() + nextIndex);
+		std::sort(meshletVertices.begin(), meshletVertices.end());
+		meshletVertices.erase(std::unique(meshletVertices.begin(), meshletVertices.end()), meshletVertices.end());
+		CHECK(meshletVertices.size() <= Utils::MESHLET_MAX_VERTICES);
+
+		//The sphere holds every vertex, the cone every face normal
+		const float minConeDot{ sqrtf(1.f - meshlet.coneCutoff * meshlet.coneCutoff) };
+		for (uint32_t i{ meshlet.firstIndex }; i < nextIndex; i += 3)
+		{
+			const Vector3& p0{ vertices[indices[i]].position };
+			for (int corner{}; corner < 3; ++corner)
+			{
+				CHECK((vertices[indices[i + corner]].position - meshlet.center).Magnitude() <= meshlet.radius * 1.0001f);
+			}
+			const Vector3 faceNormal{ Vector3::Cross(vertices[indices[i + 1]].position - p0, vertices[indices[i + 2]].position - p0).Normalized() };
+			CHECK(meshlet.coneCutoff >= 1.f || Vector3::Dot(faceNormal, meshlet.coneAxis) >= minConeDot - 1e-4f);
+		}
+	}
+	CHECK(nextIndex == indices.size());
+	CHECK(meshlets.size() >= indices.size() / 3 / Utils::MESHLET_MAX_TRIANGLES);
+
+	//A meshlet only ever gets culled when every one of its triangles faces away, the flat ones do from below
+	const Vector3 cameraPositions[]{ { 12.f, 12.f, 40.f }, { 12.f, 12.f, -40.f }, { -30.f, 5.f, 1.f }, { 12.f, 12.f, 2.f }, { 30.f, 40.f, -0.5f } };
+	uint32_t nrCulledFromBelow{};
+	for (const Vector3& cameraPosition : cameraPositions)
+	{
+		for (const Meshlet& meshlet : meshlets)
+		{
+			if (!IsConeBackFacing(meshlet.center, meshlet.radius, meshlet.coneAxis, meshlet.coneCutoff, cameraPosition))
+				continue;
+
+			nrCulledFromBelow += cameraPosition.z < -10.f;
+			for (uint32_t i{ meshlet.firstIndex }; i < meshlet.firstIndex + meshlet.nrIndices; i += 3)
+			{
+				const Vector3& p0{ vertices[indices[i]].position };
+				const Vector3 faceNormal{ Vector3::Cross(vertices[indices[i + 1]].position - p0, vertices[indices[i + 2]].position - p0) };
+				CHECK(Vector3::Dot(faceNormal, p0 - cameraPosition) >= 0.f);
+			}
+		}
+	}
+	CHECK(nrCulledFromBelow > 0);
+}
+
+//Largest vertical distance from the vertices to the surface of the (height field) triangles, every vertex has to be above or below one
+static float GetMaxVerticalDistance(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+	float maxDistance{};
+	for (const Vertex& vertex : vertices)
+	{
+		const Vector3& p{ vertex.position };
+		float distance{ FLT_MAX };
+		for (size_t i{}; i + 2 < indices.size(); i += 3)
+		{
+			const Vector3& a{ vertices[indices[i]].position };
+			const Vector3 ab{ vertices[indices[i + 1]].position - a };
+			const Vector3 ac{ vertices[indices[i + 2]].position - a };
+			const float area{ ab.x * ac.y - ab.y * ac.x };
+			if (area == 0.f)
+				continue;
+
+			const float u{ ((p.x - a.x) * ac.y - (p.y - a.y) * ac.x) / area };
+			const float v{ (ab.x * (p.y - a.y) - ab.y * (p.x - a.x)) / area };
+			if (u < -1e-5f || v < -1e-5f || u + v > 1.f + 1e-5f)
+				continue;
+
+			distance = std::min(distance, std::abs(a.z + ab.z * u + ac.z * v - p.z));
+		}
+		maxDistance = std::max(maxDistance, distance);
+	}
+	return maxDistance;
+}
+
+static void CheckSimplifier()
+{
+	//A flat grid goes down to a handful of triangles without any error, the border stays where it was
+	std::vector<Vertex> vertices{};
+	std::vector<uint32_t> indices{};
+	BuildGridMesh(12, 0.f, vertices, indices);
+	Utils::MeshSimplifier flatSimplifier{ vertices, indices };
+	CHECK(flatSimplifier.Simplify(0, 0.001f) == 0.f);
+	CHECK(flatSimplifier.simplified.size() / 3 <= 8);
+	CHECK(GetMaxVerticalDistance(vertices, flatSimplifier.simplified) == 0.f);
+
+	//Every level continues from the one before: fewer triangles, an error that only grows and stays under the limit
+	//The error bounds how far the vertices of the full mesh end up from the surface of the level
+	BuildGridMesh(24, 3.f, vertices, indices);
+	const std::vector<uint32_t> original{ indices };
+	constexpr float maxRelativeError{ 0.02f };
+	const float maxError{ sqrtf(24.f * 24.f * 2.f + 3.f * 3.f) * maxRelativeError };
+
+	std::vector<Meshlet> meshlets{};
+	std::vector<MeshLod> lods{};
+	Utils::BuildLods(vertices, indices, meshlets, lods, 6, 0.5f, maxRelativeError);
+	CHECK(lods.size() >= 4);
+	CHECK(!lods.empty() && lods[0].error == 0.f);
+
+	size_t previousNrIndices{ SIZE_MAX };
+	float previousError{};
+	for (const MeshLod& lod : lods)
+	{
+		std::vector<uint32_t> lodIndices{};
+		for (uint32_t meshletIdx{ lod.firstMeshlet }; meshletIdx < lod.firstMeshlet + lod.nrMeshlets; ++meshletIdx)
+		{
+			const Meshlet& meshlet{ meshlets[meshletIdx] };
+			lodIndices.insert(lodIndices.end(), indices.begin() + meshlet.firstIndex, indices.begin() + meshlet.firstIndex + meshlet.nrIndices);
+		}
+
+		CHECK(lodIndices.size() < previousNrIndices);
+		CHECK(lod.error >= previousError);
+		CHECK(lod.error <= maxError);
+		CHECK(GetMaxVerticalDistance(vertices, lodIndices) <= lod.error + 1e-5f);
+		previousNrIndices = lodIndices.size();
+		previousError = lod.error;
+	}
+	CHECK(previousNrIndices * 4 < original.size());
+}
+
+//Same order as a stable sort by key, for keys that differ in only the low, only the high or both bytes
+static void CheckRadixSort()
+{
+	for (const uint16_t keyMask : { uint16_t{ 0x00FF }, uint16_t{ 0xFF00 }, uint16_t{ 0xFFFF }, uint16_t{ 0x0301 } })
+	{
+		std::vector<uint16_t> keys(1000);
+		uint32_t state{ keyMask };
+		for (uint16_t& key : keys)
+		{
+			state = state * 1664525u + 1013904223u;
+			key = static_cast<uint16_t>(state >> 16) & keyMask;
+		}
+
+		std::vector<uint32_t> indices(keys.size());
+		for (uint32_t i{}; i < indices.size(); ++i)
+		{
+			indices[i] = static_cast<uint32_t>(indices.size()) - 1 - i;
+		}
+		std::vector<uint32_t> expected{ indices };
+		std::stable_sort(expected.begin(), expected.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+		std::vector<uint32_t> scratch{};
+		Utils::RadixSortByKey(indices, keys, scratch);
+		CHECK(indices == expected);
+	}
+
+	std::vector<uint32_t> empty{};
+	std::vector<uint32_t> scratch{};
+	Utils::RadixSortByKey(empty, {}, scratch);
+	CHECK(empty.empty());
+}
+
+void checks::RunUtilsChecks()
+{
+	CheckVertexCacheOrder();
+	CheckMeshlets();
+	CheckSimplifier();
+	CheckRadixSort();
+}
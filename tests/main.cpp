@@ -0,0 +1,21 @@
+#include "Checks.h"
+
+using namespace dae;
+
+int main()
+{
+	checks::RunRasterCoreChecks();
+	checks::RunUtilsChecks();
+	checks::RunCullingChecks();
+	checks::RunShadeKernelsChecks();
+	checks::RunGBufferChecks();
+
+	if (checks::g_NrFailures > 0)
+	{
+		std::cerr << checks::g_NrFailures << " check(s) failed" << std::endl;
+		return 1;
+	}
+
+	std::cout << "All checks passed" << std::endl;
+	return 0;
+}